@@ -1,6 +1,17 @@
 #pragma once
 
-#include <set>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <ufw/data.hpp>
 
 #ifndef __CLING__
 #  include <ufw/index.hpp>
@@ -32,18 +43,258 @@ namespace sand {
 
 namespace sand {
 
+  /**
+   * Read-only view of the sorted truth indices of a sand::truth. The indices of a set live in its sand::truth_pool,
+   * so the view is valid until that pool is modified, moved or destroyed. A single index is held by the view itself.
+   */
+  class truth_view {
+   public:
+    using const_iterator = const truth_index*;
+
+    truth_view() = default;
+    truth_view(const_iterator first, const_iterator last) : m_begin(first), m_end(last) {}
+    explicit truth_view(const truth_index& single) : m_single(single), m_is_single(true) {}
+
+    const_iterator begin() const { return m_is_single ? &m_single : m_begin; }
+    const_iterator end() const { return m_is_single ? &m_single + 1 : m_end; }
+    std::size_t size() const { return end() - begin(); }
+    bool empty() const { return begin() == end(); }
+    const truth_index& operator[] (std::size_t i) const { return begin()[i]; }
+    bool contains(const truth_index& i) const { return std::binary_search(begin(), end(), i); }
+
+   private:
+    const_iterator m_begin = nullptr;
+    const_iterator m_end   = nullptr;
+    truth_index m_single{};
+    bool m_is_single = false;
+  };
+
+  class truth_pool;
+
+  /**
+   * Set of the MC truth indices a product derives from, as a 32-bit handle.
+   *
+   * A truth of a single index, e.g. a photon or a photo-electron, holds that index in the handle itself: it is built
+   * anywhere, worker threads included, and read back without anything else. Larger sets are interned in a
+   * sand::truth_pool, written by the same process next to the products holding them, and the handle numbers the set
+   * in that pool. Read them with true_hits(pool) and build them with truth_pool::intern and truth_pool::merge.
+   *
+   * Truth recording can be turned off for a whole job in its sand::truth_options, or at build time with the
+   * SANDRECO_NO_TRUTH option. Truths then stay empty.
+   */
   class truth {
     
   public:
     truth() = default;
-    truth(truth_index onehit) : m_hits{onehit} {}
-    const std::set<truth_index> true_hits() const { return m_hits; }
-    inline void insert(truth_index i) { m_hits.emplace(i); }
-    inline void insert(const std::set<truth_index>& set) { m_hits.insert(set.begin(), set.end()); }
+    inline truth(truth_index onehit);
+
+    bool empty() const { return m_handle == 0; }
+    /// Whether the truth has at most one index, so that it does not refer to a pool.
+    bool self_contained() const { return m_handle == 0 || (m_handle & single_bit) != 0; }
+    std::uint32_t handle() const { return m_handle; }
+    bool operator== (const truth& other) const { return m_handle == other.m_handle; }
+    bool operator!= (const truth& other) const { return m_handle != other.m_handle; }
+
+    /// Indices of a self-contained truth. Throws for a set, which is read through its pool.
+    inline truth_view true_hits() const;
+    inline truth_view true_hits(const truth_pool& pool) const;
+
+    /// Value of an index. The ROOT dictionaries already stream a truth_index as its std::size_t value.
+    static std::size_t raw_value(const truth_index& i) {
+      static_assert(sizeof(truth_index) == sizeof(std::size_t) && std::is_trivially_copyable_v<truth_index>);
+      std::size_t value;
+      std::memcpy(&value, &i, sizeof(value));
+      return value;
+    }
+
+#ifdef SANDRECO_NO_TRUTH
+    static constexpr bool enabled() { return false; }
+#else
+    static bool enabled() { return s_enabled; }
+#endif
 
   private:
-    std::set<truth_index> m_hits;
+    friend class truth_options;
+    friend class truth_pool;
+
+    static constexpr std::uint32_t single_bit = std::uint32_t{1} << 31;
+
+#ifdef SANDRECO_NO_TRUTH
+    static void set_enabled(bool) {}
+#else
+    static void set_enabled(bool e) { s_enabled = e; }
+#endif
+    static truth from_handle(std::uint32_t h) {
+      truth t;
+      t.m_handle = h;
+      return t;
+    }
+
+    static inline bool s_enabled = true; //!
+
+    std::uint32_t m_handle{0}; ///< 0 if empty, single_bit and the index if single, else the set number plus one.
 
   };
 
+  /**
+   * Interned truth sets of the products a process writes in a context.
+   *
+   * Each set is stored once, sorted, and identical sets share their handle, so the many digis and pixels coming from
+   * the same hits cost 32 bits each. Merging two truths is a union cached on their handle pair: a digi or pixel
+   * accumulating the same hits over and over, e.g. all the photo-electrons of one ECAL hit, finds its union in the
+   * cache, and a union adding nothing returns the handle it started from.
+   *
+   * The pool is a product of its own, written and read by the tree streamer next to the products whose truths refer to
+   * it, so handles still resolve in the jobs reading them back. Only the sets are written: the lookup tables are
+   * rebuilt on the first merge after a read.
+   */
+  class truth_pool : public ufw::data::base<ufw::data::managed_tag, ufw::data::instanced_tag, ufw::data::context_tag> {
+   public:
+    /// Number of sets in the pool, self-contained truths aside.
+    std::size_t size() const { return m_ends.size(); }
+    /// Indices of a truth of this pool, or of a self-contained one.
+    inline truth_view hits(const truth& t) const;
+    /// The truth of a set of indices, in any order and with repetitions.
+    inline truth intern(std::vector<truth_index> indices);
+    /// Union of two truths of this pool, or self-contained ones.
+    inline truth merge(const truth& a, const truth& b);
+    /// Adds the indices of other to into, both of this pool or self-contained.
+    void insert(truth& into, const truth& other) { into = merge(into, other); }
+
+  private:
+    inline static std::uint64_t hash(truth_view indices);
+    inline truth add(truth_view sorted);
+    inline void index_sets();
+
+    std::vector<truth_index> m_hits;   ///< Indices of all sets, one set after the other.
+    std::vector<std::uint32_t> m_ends; ///< End of each set in m_hits.
+    std::uint64_t m_stamp{0};          ///< Changes whenever the lookup tables are rebuilt.
+
+    std::unordered_multimap<std::uint64_t, std::uint32_t> m_sets; //! Handles by set hash.
+    std::unordered_map<std::uint64_t, truth> m_unions;            //! Unions by handle pair.
+    std::uint64_t m_indexed_stamp{0};                             //! m_stamp the tables were built for.
+  };
+
+  inline truth::truth(truth_index onehit) {
+    if (!enabled()) {
+      return;
+    }
+    auto value = raw_value(onehit);
+    if (value >= single_bit) {
+      throw std::out_of_range("Truth index too large for a truth handle.");
+    }
+    m_handle = single_bit | static_cast<std::uint32_t>(value);
+  }
+
+  inline truth_view truth::true_hits() const {
+    if (m_handle == 0) {
+      return {};
+    }
+    if (!self_contained()) {
+      throw std::logic_error("Truth sets can only be read through their sand::truth_pool.");
+    }
+    return truth_view(truth_index(m_handle & ~single_bit));
+  }
+
+  inline truth_view truth::true_hits(const truth_pool& pool) const { return pool.hits(*this); }
+
+  inline truth_view truth_pool::hits(const truth& t) const {
+    if (t.self_contained()) {
+      return t.true_hits();
+    }
+    std::size_t set = t.m_handle - 1;
+    if (set >= m_ends.size()) {
+      throw std::out_of_range("Truth handle not found in its sand::truth_pool.");
+    }
+    return truth_view(m_hits.data() + (set ? m_ends[set - 1] : 0), m_hits.data() + m_ends[set]);
+  }
+
+  inline truth truth_pool::intern(std::vector<truth_index> indices) {
+    if (!truth::enabled() || indices.empty()) {
+      return {};
+    }
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+    if (indices.size() == 1) {
+      return truth(indices.front());
+    }
+    index_sets();
+    return add(truth_view(indices.data(), indices.data() + indices.size()));
+  }
+
+  inline truth truth_pool::merge(const truth& a, const truth& b) {
+    if (!truth::enabled() || b.empty() || a == b) {
+      return a;
+    }
+    if (a.empty()) {
+      return b;
+    }
+    index_sets();
+    auto key = a.m_handle < b.m_handle ? std::uint64_t{a.m_handle} << 32 | b.m_handle
+                                       : std::uint64_t{b.m_handle} << 32 | a.m_handle;
+    if (auto cached = m_unions.find(key); cached != m_unions.end()) {
+      return cached->second;
+    }
+    auto ha = hits(a);
+    auto hb = hits(b);
+    std::vector<truth_index> merged;
+    merged.reserve(ha.size() + hb.size());
+    std::set_union(ha.begin(), ha.end(), hb.begin(), hb.end(), std::back_inserter(merged));
+    auto result = merged.size() == ha.size()   ? a
+                : merged.size() == hb.size() ? b
+                                             : add(truth_view(merged.data(), merged.data() + merged.size()));
+    m_unions.emplace(key, result);
+    return result;
+  }
+
+  inline std::uint64_t truth_pool::hash(truth_view indices) {
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    for (const auto& i : indices) {
+      h = (h ^ truth::raw_value(i)) * 0x100000001b3ull;
+    }
+    return h;
+  }
+
+  inline truth truth_pool::add(truth_view sorted) {
+    auto h        = hash(sorted);
+    auto [lo, hi] = m_sets.equal_range(h);
+    for (auto it = lo; it != hi; ++it) {
+      auto set = hits(truth::from_handle(it->second));
+      if (std::equal(set.begin(), set.end(), sorted.begin(), sorted.end())) {
+        return truth::from_handle(it->second);
+      }
+    }
+    if (m_ends.size() + 1 >= truth::single_bit) {
+      throw std::length_error("Too many truth sets for a sand::truth_pool.");
+    }
+    m_hits.insert(m_hits.end(), sorted.begin(), sorted.end());
+    m_ends.push_back(static_cast<std::uint32_t>(m_hits.size()));
+    auto handle = static_cast<std::uint32_t>(m_ends.size());
+    m_sets.emplace(h, handle);
+    return truth::from_handle(handle);
+  }
+
+  /**
+   * (Re)builds the lookup tables of the sets, which are not written: for a new pool, or after the pool was read or
+   * overwritten. A pool read from a file carries the stamp of the tables of the job writing it, which never matches
+   * the one of this job's tables.
+   */
+  inline void truth_pool::index_sets() {
+    if (m_stamp != 0 && m_stamp == m_indexed_stamp) {
+      return;
+    }
+    m_sets.clear();
+    m_unions.clear();
+    for (std::uint32_t handle = 1; handle <= m_ends.size(); ++handle) {
+      m_sets.emplace(hash(hits(truth::from_handle(handle))), handle);
+    }
+    std::random_device entropy;
+    do {
+      m_stamp = std::uint64_t{entropy()} << 32 | entropy();
+    } while (m_stamp == 0);
+    m_indexed_stamp = m_stamp;
+  }
+
 } // namespace sand
+
+UFW_DECLARE_MANAGED_DATA(sand::truth_pool)
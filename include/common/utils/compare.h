@@ -0,0 +1,54 @@
+#pragma once
+
+#include <ufw/utils.hpp>
+
+#include <common/truth.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <string_view>
+
+namespace sand::utils {
+
+  /// Whether two values are equal, NaNs standing for values which are not set and being equal to each other.
+  inline bool same(double a, double b) { return a == b || (std::isnan(a) && std::isnan(b)); }
+
+  /// Whether two products carry the same true hits, each read through the sand::truth_pool of its product.
+  inline bool same_truth(const truth& a, const truth_pool& pool_a, const truth& b, const truth_pool& pool_b) {
+    auto ta = a.true_hits(pool_a);
+    auto tb = b.true_hits(pool_b);
+    return std::equal(ta.begin(), ta.end(), tb.begin(), tb.end());
+  }
+
+  /// Whether two products carry the same true hits, for products whose truths have a single index at most.
+  inline bool same_truth(const truth& a, const truth& b) {
+    auto ta = a.true_hits();
+    auto tb = b.true_hits();
+    return std::equal(ta.begin(), ta.end(), tb.begin(), tb.end());
+  }
+
+  /**
+   * Checks a sequence against a reference one, element by element, as done by the processes comparing the products
+   * of two configurations which must give the same output. Raises an error if the sizes differ or naming the first
+   * element for which equal(element, reference element) is false.
+   * @param what Name of the elements in the messages, in the plural, e.g. "signals".
+   */
+  template <typename Tested, typename Reference, typename Equal>
+  void check_same(const Tested& tested, const Reference& reference, Equal&& equal, std::string_view what) {
+    if (std::size(tested) != std::size(reference)) {
+      UFW_ERROR("Found {} {}, the reference has {}.", std::size(tested), what, std::size(reference));
+    }
+    std::size_t i = 0;
+    auto other    = std::begin(reference);
+    for (const auto& element : tested) {
+      if (!equal(element, *other)) {
+        UFW_ERROR("Element {} of the {} differs from the reference one.", i, what);
+      }
+      ++other;
+      ++i;
+    }
+  }
+
+} // namespace sand::utils
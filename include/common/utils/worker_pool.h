@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sand::utils {
+
+  /**
+   * A fixed set of threads, started once and reused by every parallel_for.
+   *
+   * The calling thread takes part in each parallel_for, so a pool of n threads starts n - 1 workers. Each worker runs
+   * on_start when it starts and on_exit before it ends, e.g. to set up and release per-thread resources such as a
+   * geometry navigator. Hooks must not throw. A pool runs one parallel_for at a time.
+   */
+  class worker_pool {
+   public:
+    using hook = std::function<void()>;
+
+    explicit worker_pool(std::size_t threads, hook on_start = {}, hook on_exit = {});
+    ~worker_pool();
+
+    worker_pool(const worker_pool&)             = delete;
+    worker_pool& operator= (const worker_pool&) = delete;
+
+    /// Number of threads running the tasks, the calling one included.
+    std::size_t size() const { return m_workers.size() + 1; }
+
+    /**
+     * Runs task(i) for each i in [0, n), returning once all of them ran. Tasks are handed out one at a time, so their
+     * order across threads is not defined. The first exception thrown by a task stops the remaining ones and is
+     * rethrown here.
+     */
+    template <typename Task>
+    void parallel_for(std::size_t n, Task&& task);
+
+   private:
+    void loop(const hook& on_start, const hook& on_exit);
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_call_mutex;
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+    std::function<void()> m_job;
+    std::uint64_t m_generation{0};
+    std::size_t m_running{0};
+    bool m_stop{false};
+  };
+
+  inline worker_pool::worker_pool(std::size_t threads, hook on_start, hook on_exit) {
+    for (std::size_t t = 1; t < threads; ++t) {
+      m_workers.emplace_back([this, on_start, on_exit] { loop(on_start, on_exit); });
+    }
+  }
+
+  inline worker_pool::~worker_pool() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_start.notify_all();
+    for (auto& worker : m_workers) {
+      worker.join();
+    }
+  }
+
+  inline void worker_pool::loop(const hook& on_start, const hook& on_exit) {
+    if (on_start) {
+      on_start();
+    }
+    std::uint64_t seen = 0;
+    while (true) {
+      std::function<void()> job;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_start.wait(lock, [&] { return m_stop || m_generation != seen; });
+        if (m_stop) {
+          break;
+        }
+        seen = m_generation;
+        job  = m_job;
+      }
+      job();
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (--m_running == 0) {
+        m_done.notify_all();
+      }
+    }
+    if (on_exit) {
+      on_exit();
+    }
+  }
+
+  template <typename Task>
+  void worker_pool::parallel_for(std::size_t n, Task&& task) {
+    if (m_workers.empty() || n <= 1) {
+      for (std::size_t i = 0; i < n; ++i) {
+        task(i);
+      }
+      return;
+    }
+    std::lock_guard<std::mutex> call_lock(m_call_mutex);
+    std::atomic<std::size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto work = [&] {
+      try {
+        for (auto i = next++; i < n; i = next++) {
+          task(i);
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        next = n;
+      }
+    };
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_job     = work;
+      m_running = m_workers.size();
+      ++m_generation;
+    }
+    m_start.notify_all();
+    work();
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_done.wait(lock, [this] { return m_running == 0; });
+      m_job = nullptr;
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+} // namespace sand::utils
@@ -24,6 +24,10 @@ namespace sand::ecal {
       /// @param tm Arrival time of the photo-electron (in nanoseconds or appropriate unit)
       photo_electron(truth_index idx, double tm) : sand::truth(idx), arrival_time(tm) {};
 
+      /// @brief Constructor for a photo-electron without MC truth
+      /// @param tm Arrival time of the photo-electron (in nanoseconds or appropriate unit)
+      explicit photo_electron(double tm) : sand::truth(), arrival_time(tm) {};
+
       /// @brief Arrival time of the photo-electron
       double arrival_time;
     };
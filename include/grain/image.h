@@ -26,7 +26,7 @@ namespace sand::grain {
       pixel_array<T> amplitude_array() const;
       template <typename T>
       pixel_array<T> time_array() const;
-      inline sand::truth all_hits() const;
+      inline sand::truth all_hits(truth_pool& pool) const;
     };
 
     using image_list = std::vector<image>;
@@ -50,10 +50,11 @@ namespace sand::grain {
     return ret;
   }
 
-  inline sand::truth images::image::all_hits() const {
+  /// Union of the truths of all pixels, interned in the pool of the images.
+  inline sand::truth images::image::all_hits(truth_pool& pool) const {
     sand::truth hits;
     for (const pixel& p : pixels) {
-      hits.insert(p.true_hits());
+      pool.insert(hits, p);
     }
     return hits;
   }
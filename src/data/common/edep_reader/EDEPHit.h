@@ -118,6 +118,8 @@ class EDEPHit {
 
   /**
    * @brief Get the ID of the hit.
+   * @details For hits read from an EDepSim event this is the position of the segment among all the segments of the
+   *          event, i.e. its truth index.
    * @return The ID as an integer.
    */
   const int& GetId() const { return h_index; };
@@ -136,4 +138,4 @@ class EDEPHit {
 /**
  * @brief Alias for a map of component to vector of EDEPHit.
  */
-using EDEPHitsMap = std::map<component, std::vector<EDEPHit>>;
+using EDEPHitsMap = EDEPComponentMap<std::vector<EDEPHit>>;
@@ -9,21 +9,19 @@
 /**
  * @brief Retrieves the geometric node corresponding to a trajectory point.
  * @param tpoint The trajectory point.
- * @param geo The TGeoManager object representing the geometry.
+ * @param navigator The navigator used for the lookup, owned by the calling thread.
  * @return Pointer to the geometric node.
  */
-TGeoNode* GetNode(const TG4TrajectoryPoint& tpoint) {
+TGeoNode* GetNode(const TG4TrajectoryPoint& tpoint, TGeoNavigator* navigator) {
 
-  auto& tgm        = ufw::context::current()->instance<sand::root_tgeomanager>();
-  
   TGeoNode* node = nullptr;
 
   sand::vec_4d position = tpoint.GetPosition();
   sand::mom_3d mom(tpoint.GetMomentum().X(), tpoint.GetMomentum().Y(), tpoint.GetMomentum().Z());
 
-  node = tgm.navigator()->FindNode(position.X(), position.Y(), position.Z());
+  node = navigator->FindNode(position.X(), position.Y(), position.Z());
 
-  tgm.navigator()->SetCurrentDirection(mom.X(), mom.Y(), mom.Z());
+  navigator->SetCurrentDirection(mom.X(), mom.Y(), mom.Z());
 
   // Notice: this is a fix for cases of P = 0.
   //         Particle not moving means FindNextBoundary will not converge
@@ -31,16 +29,43 @@ TGeoNode* GetNode(const TG4TrajectoryPoint& tpoint) {
   if (abs(mom.X()) == 0 && abs(mom.Y()) == 0 && abs(mom.Z()) == 0) {
     return node;
   }
-  tgm.navigator()->FindNextBoundary(1000);
+  navigator->FindNextBoundary(1000);
 
-  if (tgm.navigator()->GetStep() < 1E-5) {
-    tgm.navigator()->Step();
-    node = tgm.navigator()->GetCurrentNode();
+  if (navigator->GetStep() < 1E-5) {
+    navigator->Step();
+    node = navigator->GetCurrentNode();
   }
 
   return node;
 }
 
+/**
+ * @brief Bit of a detector component in the masks returned by GetComponentMasks.
+ * @param comp The detector component.
+ * @return The bit mask with only this component set.
+ */
+constexpr std::uint8_t ComponentBit(component comp) { return 1 << static_cast<int>(comp); }
+
+/**
+ * @brief Masks of the detector components whose volume names each node of the geometry matches.
+ * @details The table is built once per geometry and owned by it, see root_tgeomanager::name_masks.
+ * @param geometry The geometry of the trajectory points.
+ * @return The table, giving the components of a node as a bit mask, see ComponentBit.
+ */
+const sand::root_tgeomanager::node_name_masks& GetComponentMasks(sand::root_tgeomanager& geometry) {
+  static const sand::root_tgeomanager::node_name_masks::name_sets component_names = [] {
+    sand::root_tgeomanager::node_name_masks::name_sets names(static_cast<int>(component::OTHER));
+    names[static_cast<int>(component::GRAIN)]  = grain_names;
+    names[static_cast<int>(component::STRAW)]  = stt_names;
+    names[static_cast<int>(component::DRIFT)]  = drift_names;
+    names[static_cast<int>(component::ECAL)]   = ecal_names;
+    names[static_cast<int>(component::MAGNET)] = magnet_names;
+    names[static_cast<int>(component::WORLD)]  = world_names;
+    return names;
+  }();
+  return geometry.name_masks(component_names);
+}
+
 // Notice: this works (I think) but I don't like it.
 /**
  * @brief Checks for transitions between detector components in a particle trajectory.
@@ -101,12 +126,16 @@ void EDEPTrajectory::CheckInNext(bool* in, bool* next, TG4TrajectoryPoint it, TG
  * @param trajectory The TG4Trajectory object to be converted.
  * @param hits A map of hit segment detectors, containing hits associated with different components.
  * @param primaries A container for primary vertex information to track interaction number and reaction type.
+ * @param trajectory_points Whether to classify the trajectory points, which requires a geometry lookup for each of
+ *                          them. If false the trajectory has no points and never enters or exits a component.
+ * @param geometry Geometry used to classify the points, the one of the current context if nullptr. Threads other than
+ *                 the one running the context must pass it, each of them then navigates with its own navigator.
  */
 EDEPTrajectory::EDEPTrajectory(const TG4Trajectory& trajectory,
-                               const std::map<int, std::map<component, std::vector<EDEPHit>>>& hit_map,
-                               const TG4PrimaryVertexContainer& primaries)
+                               const std::map<int, EDEPHitsMap>& hit_map,
+                               const TG4PrimaryVertexContainer& primaries, bool trajectory_points,
+                               sand::root_tgeomanager* geometry)
   : p0_(trajectory.GetInitialMomentum()),
-    parent_trajectory_(nullptr),
     id_(trajectory.GetTrackId()),
     parent_id_(trajectory.GetParentId()),
     pdg_code_(trajectory.GetPDGCode()) {
@@ -129,32 +158,46 @@ EDEPTrajectory::EDEPTrajectory(const TG4Trajectory& trajectory,
     entering_map_[comp.second] = false;
   }
 
+  if (hit_map.find(id_) != hit_map.end()) {
+    hit_map_ = hit_map.at(id_);
+    for (auto& hits : hit_map_) {
+      std::sort(hits.second.begin(), hits.second.end(),
+                [](EDEPHit i, EDEPHit j) { return i.GetStart().T() < j.GetStart().T(); });
+    }
+  }
+
+  if (!trajectory_points) {
+    return;
+  }
+
+  if (geometry == nullptr) {
+    geometry = &ufw::context::current()->instance<sand::root_tgeomanager>();
+  }
+  auto navigator              = geometry->navigator();
+  const auto& node_components = GetComponentMasks(*geometry);
+
+  std::uint32_t next_components = 0;
   for (auto it = trajectory.Points.begin(); it != trajectory.Points.end(); ++it) {
     auto next_it = std::next(it);
 
-    auto current_node   = GetNode(*it);
-    std::string current_volume;
-    if(current_node != nullptr ){
-          current_volume = current_node->GetName();
-    } else {
-      current_volume = "";
-    }
+    // each point is located once, as the next point of the previous step
+    auto current_components = it == trajectory.Points.begin() ? node_components(GetNode(*it, navigator.get())) : next_components;
 
-    component comp;
-    bool in_grain   = Match(current_volume, grain_names);
+    component comp = component::OTHER;
+    bool in_grain   = current_components & ComponentBit(component::GRAIN);
     if(in_grain) comp = component::GRAIN;
 
-    bool in_ecal    = Match(current_volume, ecal_names);
+    bool in_ecal    = current_components & ComponentBit(component::ECAL);
     if(in_ecal) comp = component::ECAL;
 
-    bool in_mag     = Match(current_volume, magnet_names);
+    bool in_mag     = current_components & ComponentBit(component::MAGNET);
     if(in_mag) comp = component::MAGNET;
 
-    bool in_world   = Match(current_volume, world_names);
+    bool in_world   = current_components & ComponentBit(component::WORLD);
     if(in_world) comp = component::WORLD;
 
-    bool in_stt     = Match(current_volume, stt_names);
-    bool in_drift   = Match(current_volume, drift_names);
+    bool in_stt     = current_components & ComponentBit(component::STRAW);
+    bool in_drift   = current_components & ComponentBit(component::DRIFT);
 
     if(in_stt )   comp = component::STRAW;
     if(in_drift)  comp = component::DRIFT;
@@ -190,72 +233,120 @@ EDEPTrajectory::EDEPTrajectory(const TG4Trajectory& trajectory,
       continue;
     }
 
-    auto next_node   = GetNode(*next_it);
-    std::string next_volume;
-    if(next_node != nullptr){
-        next_volume = next_node->GetName();
-    } else {
-      next_volume = "";
-    }
+    next_components = node_components(GetNode(*next_it, navigator.get()));
 
-    bool next_grain = Match(next_volume,    grain_names);
-    bool next_stt   = Match(next_volume,    stt_names);
-    bool next_drift = Match(next_volume,    drift_names);
-    bool next_ecal  = Match(next_volume,    ecal_names);
-    bool next_mag   = Match(next_volume,    magnet_names);
-    bool next_world = Match(next_volume,    world_names);
+    bool next_grain = next_components & ComponentBit(component::GRAIN);
+    bool next_stt   = next_components & ComponentBit(component::STRAW);
+    bool next_drift = next_components & ComponentBit(component::DRIFT);
+    bool next_ecal  = next_components & ComponentBit(component::ECAL);
+    bool next_mag   = next_components & ComponentBit(component::MAGNET);
+    bool next_world = next_components & ComponentBit(component::WORLD);
 
     bool      in[6]   = {in_grain,   in_stt,   in_drift,   in_ecal,   in_mag,   in_world};
     bool      next[6] = {next_grain, next_stt, next_drift, next_ecal, next_mag, next_world};
     CheckInNext(in, next, *it, *next_it);
 
   }
+}
 
-  if (hit_map.find(id_) != hit_map.end()) {
-    hit_map_ = hit_map.at(id_);
-    for (auto& hits : hit_map_) {
-      std::sort(hits.second.begin(), hits.second.end(),
-                [](EDEPHit i, EDEPHit j) { return i.GetStart().T() < j.GetStart().T(); });
-    }
-  }
+/**
+ * @brief Copy constructor for EDEPTrajectory.
+ * @param trj The EDEPTrajectory object to copy, with all its descendants.
+ */
+EDEPTrajectory::EDEPTrajectory(const EDEPTrajectory& trj) : EDEPTrajectory(trj, node_copy_tag{}) {
+  parent_offset_ = 0;
+  owner_         = trj.GetParent();
+  CopyDescendants(trj);
 }
 
 /**
- * @brief Copy constructor for the EDEPTrajectory class.
- * @param trj The EDEPTrajectory object to copy.
+ * @brief Move constructor for EDEPTrajectory.
+ * @param trj The EDEPTrajectory object to move.
  */
-EDEPTrajectory::EDEPTrajectory(const EDEPTrajectory& trj) { *this = trj; }
+EDEPTrajectory::EDEPTrajectory(EDEPTrajectory&& trj) noexcept : EDEPTrajectory() { *this = std::move(trj); }
 
 /**
- * @brief Copy assignment operator for the EDEPTrajectory class.
+ * @brief Copies the data of a trajectory, without its descendants.
+ * @details The parent offset and the subtree size are copied as they are. They stay valid when the copy is stored at
+ *          the same distance from its parent, as when a whole arena or subtree is copied. The owner of the arena is
+ *          left to be set by the new one.
  * @param trj The EDEPTrajectory object to copy.
- * @return Reference to the copied EDEPTrajectory object.
  */
+EDEPTrajectory::EDEPTrajectory(const EDEPTrajectory& trj, node_copy_tag)
+  : p0_(trj.p0_),
+    hit_map_(trj.hit_map_),
+    trajectory_points_(trj.trajectory_points_),
+    exiting_map_(trj.exiting_map_),
+    entering_map_(trj.entering_map_),
+    last_points_(trj.last_points_),
+    first_points_(trj.first_points_),
+    parent_offset_(trj.parent_offset_),
+    subtree_size_(trj.subtree_size_),
+    id_(trj.id_),
+    parent_id_(trj.parent_id_),
+    pdg_code_(trj.pdg_code_),
+    depth_(trj.depth_),
+    interaction_number_(trj.interaction_number_),
+    reaction_(trj.reaction_) {}
+
 EDEPTrajectory& EDEPTrajectory::operator= (const EDEPTrajectory& trj) {
-  this->id_                    = trj.id_;
-  this->parent_id_             = trj.parent_id_;
-  this->parent_trajectory_     = trj.parent_trajectory_;
-  this->pdg_code_              = trj.pdg_code_;
-  this->p0_                    = trj.p0_;
-  this->depth_                 = trj.depth_;
-  this->interaction_number_    = trj.interaction_number_;
-  this->reaction_              = trj.reaction_;
-  this->children_trajectories_ = trj.children_trajectories_;
-  for (auto& t : this->children_trajectories_) {
-    t.parent_trajectory_ = this;
-  }
-  this->hit_map_           = trj.hit_map_;
-  this->entering_map_      = trj.entering_map_;
-  this->exiting_map_       = trj.exiting_map_;
-  this->last_points_       = trj.last_points_;
-  this->first_points_      = trj.first_points_;
-  this->trajectory_points_ = trj.trajectory_points_;
+  EDEPTrajectory copy(trj);
+  return *this = std::move(copy);
+}
+
+EDEPTrajectory& EDEPTrajectory::operator= (EDEPTrajectory&& trj) noexcept {
+  p0_                 = std::move(trj.p0_);
+  hit_map_            = std::move(trj.hit_map_);
+  trajectory_points_  = std::move(trj.trajectory_points_);
+  exiting_map_        = std::move(trj.exiting_map_);
+  entering_map_       = std::move(trj.entering_map_);
+  last_points_        = std::move(trj.last_points_);
+  first_points_       = std::move(trj.first_points_);
+  parent_offset_      = trj.parent_offset_;
+  owner_              = trj.owner_;
+  subtree_size_       = trj.subtree_size_;
+  arena_              = std::move(trj.arena_);
+  id_                 = trj.id_;
+  parent_id_          = trj.parent_id_;
+  pdg_code_           = trj.pdg_code_;
+  depth_              = trj.depth_;
+  interaction_number_ = trj.interaction_number_;
+  reaction_           = std::move(trj.reaction_);
+  LinkArena();
   return *this;
 }
 
+/**
+ * @brief Replaces the descendants of this trajectory with copies of the descendants of another one.
+ * @details The descendants keep their relative positions, so only the children of @p trj, whose parent now owns the
+ *          arena, get a new parent offset and this trajectory as owner.
+ * @param trj The trajectory whose descendants are copied, part of a tree or a copy itself.
+ */
+void EDEPTrajectory::CopyDescendants(const EDEPTrajectory& trj) {
+  arena_.clear();
+  arena_.reserve(trj.DescendantsEnd() - trj.DescendantsBegin());
+  for (auto descendant = trj.DescendantsBegin(); descendant != trj.DescendantsEnd(); ++descendant) {
+    arena_.emplace_back(*descendant, node_copy_tag{});
+  }
+  subtree_size_ = arena_.size() + 1;
+  for (auto& child : GetChildrenTrajectories()) {
+    child.parent_offset_ = 0;
+  }
+  LinkArena();
+}
+
+/**
+ * @brief Makes this trajectory the owner, and so the parent, of the top level of its arena.
+ */
+void EDEPTrajectory::LinkArena() noexcept {
+  for (auto trj = arena_.data(); trj != arena_.data() + arena_.size(); trj += trj->subtree_size_) {
+    trj->owner_ = this;
+  }
+}
+
 bool EDEPTrajectory::operator== (const EDEPTrajectory& trj) {
   return (this->id_ == trj.id_ && this->parent_id_ == trj.parent_id_
-          && this->parent_trajectory_ == trj.parent_trajectory_ && this->pdg_code_ == trj.pdg_code_
+          && this->GetParent() == trj.GetParent() && this->pdg_code_ == trj.pdg_code_
           && this->p0_ == trj.p0_ && this->depth_ == trj.depth_ && this->interaction_number_ == trj.interaction_number_
           && this->reaction_ == trj.reaction_ &&
           // this->children_trajectories_ == trj.children_trajectories_ &&
@@ -267,56 +358,6 @@ bool EDEPTrajectory::operator== (const EDEPTrajectory& trj) {
   );
 }
 
-/**
- * @brief Copy assignment operator for the EDEPTrajectory class.
- * @param trj The EDEPTrajectory object to copy.
- * @return Reference to the copied EDEPTrajectory object.
- */
-EDEPTrajectory::EDEPTrajectory(EDEPTrajectory&& trj) { *this = std::move(trj); }
-
-/**
- * @brief Move assignment operator for the EDEPTrajectory class.
- * @param trj The EDEPTrajectory object to move.
- * @return Reference to the moved EDEPTrajectory object.
- */
-EDEPTrajectory& EDEPTrajectory::operator= (EDEPTrajectory&& trj) {
-  this->id_                 = trj.id_;
-  this->parent_id_          = trj.parent_id_;
-  this->parent_trajectory_  = trj.parent_trajectory_;
-  this->pdg_code_           = trj.pdg_code_;
-  this->p0_                 = trj.p0_;
-  this->depth_              = trj.depth_;
-  this->interaction_number_ = trj.interaction_number_;
-  this->reaction_           = trj.reaction_;
-  std::swap(this->children_trajectories_, trj.children_trajectories_);
-  std::swap(this->hit_map_, trj.hit_map_);
-  std::swap(this->entering_map_, trj.entering_map_);
-  std::swap(this->exiting_map_, trj.exiting_map_);
-  std::swap(this->first_points_, trj.first_points_);
-  std::swap(this->last_points_, trj.last_points_);
-  std::swap(this->trajectory_points_, trj.trajectory_points_);
-  for (auto& t : this->children_trajectories_) {
-    t.parent_trajectory_ = this;
-  }
-
-  trj.parent_trajectory_ = nullptr;
-  return *this;
-}
-
-/**
- * @brief Removes a child trajectory with the given ID.
- * @param child_id ID of the child trajectory to remove.
- * @return True if a child with the given ID was removed, otherwise false.
- */
-bool EDEPTrajectory::RemoveChildWithId(int child_id) {
-  auto end = std::remove_if(children_trajectories_.begin(), children_trajectories_.end(),
-                            [child_id](const EDEPTrajectory& trj) { return trj.GetId() == child_id; });
-  auto b   = children_trajectories_.end() != end;
-  children_trajectories_.erase(end, children_trajectories_.end());
-
-  return b;
-}
-
 /**
  * @brief Prints the trajectory information to stdout and stores it in a string.
  * @param full_out Reference to a string to store the trajectory information.
@@ -361,8 +402,8 @@ std::string EDEPTrajectory::Print(std::string& full_out, int depth, int current_
         full_out += "\n";
       }
     }
-    for (uint i = 0; i < this->children_trajectories_.size(); ++i) {
-      this->children_trajectories_.at(i).Print(full_out, depth, current_depth + 1);
+    for (const auto& child : GetChildrenTrajectories()) {
+      child.Print(full_out, depth, current_depth + 1);
     }
   }
 
@@ -370,11 +411,11 @@ std::string EDEPTrajectory::Print(std::string& full_out, int depth, int current_
 }
 
 /**
- * @brief Computes the depth of the trajectory in the tree.
+ * @brief Computes the depth of the trajectory in the tree, 0 for its primaries.
  */
 void EDEPTrajectory::ComputeDepth() {
   int depth       = -1;
-  auto tmp_parent = parent_trajectory_;
+  auto tmp_parent = GetParent();
   while (tmp_parent != nullptr) {
     depth++;
     tmp_parent = tmp_parent->GetParent();
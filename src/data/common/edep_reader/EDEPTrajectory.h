@@ -3,6 +3,18 @@
 #include <edep_reader/EDEPHit.h>
 #include <edep_reader/EDEPTrajectoryPoint.h>
 
+template <typename T>
+class EDEPTrajectoryChildren;
+
+namespace sand {
+  class root_tgeomanager;
+} // namespace sand
+
+namespace sand::edep_cache {
+  class reader;
+  class writer;
+} // namespace sand::edep_cache
+
 /**
  * @class EDEPTrajectory
  * @brief Represents a trajectory of a particle through a detector.
@@ -13,21 +25,27 @@
 class EDEPTrajectory {
  public:
   // Constructors
-  EDEPTrajectory() : p0_(0, 0, 0, 0), parent_trajectory_(nullptr), id_(-1), parent_id_(-99), pdg_code_(0) {};
+  EDEPTrajectory() : p0_(0, 0, 0, 0), id_(-1), parent_id_(-99), pdg_code_(0) {};
 
   EDEPTrajectory(const TG4Trajectory& trajectory)
     : p0_(trajectory.GetInitialMomentum()),
-      parent_trajectory_(nullptr),
       id_(trajectory.GetTrackId()),
       parent_id_(trajectory.GetParentId()),
       pdg_code_(trajectory.GetPDGCode()) {};
 
   EDEPTrajectory(const TG4Trajectory& trajectory,
-                 const std::map<int, std::map<component, std::vector<EDEPHit>>>& hit_map,
-                 const TG4PrimaryVertexContainer& primaries);
+                 const std::map<int, EDEPHitsMap>& hit_map,
+                 const TG4PrimaryVertexContainer& primaries, bool trajectory_points = true,
+                 sand::root_tgeomanager* geometry = nullptr);
 
+  /**
+   * @brief Copy constructor for EDEPTrajectory.
+   * @details The copy owns copies of all the descendants of @p trj, so it stays valid when the tree holding @p trj
+   *          changes or goes away. The copy keeps the parent of @p trj, which must outlive it for GetParent to be
+   *          used.
+   */
   EDEPTrajectory(const EDEPTrajectory& trj);
-  EDEPTrajectory(EDEPTrajectory&& trj);
+  EDEPTrajectory(EDEPTrajectory&& trj) noexcept;
   /**
    * @brief Destructor for EDEPTrajectory.
    */
@@ -53,7 +71,7 @@ class EDEPTrajectory {
    * @param trj The EDEPTrajectory object to move.
    * @return Reference to the moved EDEPTrajectory object.
    */
-  EDEPTrajectory& operator= (EDEPTrajectory&& trj);
+  EDEPTrajectory& operator= (EDEPTrajectory&& trj) noexcept;
 
   // Getters
 
@@ -71,9 +89,13 @@ class EDEPTrajectory {
 
   /**
    * @brief Get the parent trajectory of this trajectory.
-   * @return Pointer to the parent trajectory.
+   * @details The parent is found from its position in the arena holding both. The primaries of a tree and the
+   *          children of a copy have as parent the tree or the copy, which owns their arena.
+   * @return Pointer to the parent trajectory, or nullptr if there is none.
    */
-  EDEPTrajectory* GetParent() const { return parent_trajectory_; };
+  EDEPTrajectory* GetParent() const {
+    return parent_offset_ ? const_cast<EDEPTrajectory*>(this) - parent_offset_ : owner_;
+  };
 
   /**
    * @brief Get the ID of this trajectory.
@@ -122,15 +144,23 @@ class EDEPTrajectory {
 
   /**
    * @brief Get the children trajectories of this trajectory.
-   * @return Reference to the vector of children trajectories.
+   * @details The children of a trajectory of an EDEPTree are stored in the arena of the tree, those of a copy in the
+   *          copy itself.
+   * @return Range over the children trajectories.
    */
-  std::vector<EDEPTrajectory>& GetChildrenTrajectories() { return children_trajectories_; };
+  EDEPTrajectoryChildren<EDEPTrajectory> GetChildrenTrajectories();
 
   /**
    * @brief Get the const children trajectories of this trajectory.
-   * @return Const reference to the vector of children trajectories.
+   * @return Const range over the children trajectories.
    */
-  const std::vector<EDEPTrajectory>& GetChildrenTrajectories() const { return children_trajectories_; };
+  EDEPTrajectoryChildren<const EDEPTrajectory> GetChildrenTrajectories() const;
+
+  /**
+   * @brief Get the number of trajectories in the subtree of this trajectory, itself included.
+   * @return The size of the subtree.
+   */
+  std::size_t GetSubtreeSize() const { return subtree_size_; };
 
   /**
    * @brief Get the hit map associated with this trajectory.
@@ -144,6 +174,18 @@ class EDEPTrajectory {
    */
   const EDEPTrajectoryPoints& GetTrajectoryPoints() const { return trajectory_points_; };
 
+  /**
+   * @brief Get the points where this trajectory enters each detector component.
+   * @return Const reference to the first points in each component.
+   */
+  const EDEPTrajectoryPoints& GetFirstPoints() const { return first_points_; };
+
+  /**
+   * @brief Get the points where this trajectory leaves each detector component.
+   * @return Const reference to the last points in each component.
+   */
+  const EDEPTrajectoryPoints& GetLastPoints() const { return last_points_; };
+
   /**
    * @brief Get the trajectory points associated with this trajectory.
    * @return All trajectory points associated with this trajectory ordered by increasing times.
@@ -172,22 +214,17 @@ class EDEPTrajectory {
 
   /**
    * @brief Set the parent trajectory of this trajectory.
-   * @param parent_trajectory The parent trajectory to set.
+   * @details Only for a trajectory outside of an arena, e.g. a copy or a tree: the parents of the trajectories of an
+   *          arena are kept by its owner.
+   * @param parent_trajectory The parent trajectory to set, or nullptr.
    */
-  void SetParent(EDEPTrajectory* parent_trajectory) { parent_trajectory_ = parent_trajectory; };
+  void SetParent(EDEPTrajectory* parent_trajectory) {
+    parent_offset_ = 0;
+    owner_         = parent_trajectory;
+  };
 
   // Other
 
-  /**
-   * @brief Add a child trajectory to this trajectory.
-   * @param trajectory The child trajectory to add.
-   */
-  void AddChild(const EDEPTrajectory& trajectory) {
-    children_trajectories_.push_back(trajectory);
-    children_trajectories_.back().SetParent(this);
-  };
-  bool RemoveChildWithId(int child_id);
-
   void ComputeDepth();
 
   // Utilities
@@ -246,17 +283,41 @@ class EDEPTrajectory {
   void CheckInNext(bool* in, bool* next, TG4TrajectoryPoint it, TG4TrajectoryPoint next_it);
 
   friend class EDEPTree;
+  friend class sand::edep_cache::reader;
+  friend class sand::edep_cache::writer;
 
  private:
-  sand::vec_4d p0_;                                 ///< Initial momentum of the trajectory.
-  EDEPHitsMap hit_map_;                               ///< Map of hits associated with the trajectory.
-  EDEPTrajectoryPoints trajectory_points_;            ///< Trajectory points.
-  std::vector<EDEPTrajectory> children_trajectories_; ///< Children trajectories.
-  std::map<component, bool> exiting_map_;             ///< Map indicating whether the trajectory is exiting a component.
-  std::map<component, bool> entering_map_; ///< Map indicating whether the trajectory is entering a component.
+  struct node_copy_tag {};
+
+ public:
+  /**
+   * @brief Copies the data of a trajectory, without its descendants.
+   * @details Only usable by EDEPTree, which links the copies itself.
+   */
+  EDEPTrajectory(const EDEPTrajectory& trj, node_copy_tag);
+
+ private:
+  const EDEPTrajectory* DescendantsBegin() const;
+  const EDEPTrajectory* DescendantsEnd() const;
+  void CopyDescendants(const EDEPTrajectory& trj);
+  void LinkArena() noexcept;
+
+  /// Parent of the trajectory within the arena holding it, nullptr for the top level of the arena.
+  EDEPTrajectory* ArenaParent() const {
+    return parent_offset_ ? const_cast<EDEPTrajectory*>(this) - parent_offset_ : nullptr;
+  }
+
+  sand::vec_4d p0_;                        ///< Initial momentum of the trajectory.
+  EDEPHitsMap hit_map_;                    ///< Map of hits associated with the trajectory.
+  EDEPTrajectoryPoints trajectory_points_; ///< Trajectory points.
+  EDEPComponentMap<bool> exiting_map_;     ///< Map indicating whether the trajectory is exiting a component.
+  EDEPComponentMap<bool> entering_map_;    ///< Map indicating whether the trajectory is entering a component.
   EDEPTrajectoryPoints last_points_;       ///< Map of all the first points in each component.
   EDEPTrajectoryPoints first_points_;      ///< Map of all the last points in each component.
-  EDEPTrajectory* parent_trajectory_;      ///< Pointer to the parent trajectory.
+  std::ptrdiff_t parent_offset_ = 0;      ///< Positions back to the parent in the arena, 0 if the parent owns it.
+  EDEPTrajectory* owner_        = nullptr; ///< Parent when parent_offset_ is 0: the owner of the arena, if any.
+  std::size_t subtree_size_     = 1;      ///< Number of trajectories in the subtree, this one included.
+  std::vector<EDEPTrajectory> arena_;     ///< Descendants owned by a tree or a copy, in depth-first order.
   int id_;                                 ///< ID of the trajectory.
   int parent_id_;                          ///< Parent ID of the trajectory.
   int pdg_code_;                           ///< PDG code of the trajectory.
@@ -264,3 +325,78 @@ class EDEPTrajectory {
   int interaction_number_ = -1;            ///< Number of the interaction that generated this trajectory.
   std::string reaction_   = "";            ///< String corresponding to the reaction that generated this trajectory.
 };
+
+/**
+ * @class EDEPTrajectoryChildren
+ * @brief Range over the children of a trajectory.
+ *
+ * Trajectories of an EDEPTree are stored in pre-order in a single arena, so the children of a trajectory are not
+ * adjacent: the iterator jumps over the subtree of each child to reach the next sibling.
+ */
+template <typename T>
+class EDEPTrajectoryChildren {
+ public:
+  class iterator {
+   public:
+    typedef T value_type;
+    typedef std::forward_iterator_tag iterator_category;
+    typedef ptrdiff_t difference_type;
+    typedef value_type* pointer;
+    typedef value_type& reference;
+
+    iterator() = default;
+    explicit iterator(pointer trj) : current_(trj) {};
+
+    reference operator* () const { return *current_; };
+    pointer operator->() const { return current_; };
+    bool operator== (const iterator& it) const { return current_ == it.current_; };
+    bool operator!= (const iterator& it) const { return current_ != it.current_; };
+    iterator& operator++ () {
+      current_ += current_->GetSubtreeSize();
+      return *this;
+    }; // ++it
+    iterator operator++ (int) {
+      iterator tmpIt = *this;
+      ++*this;
+      return tmpIt;
+    }; // it++
+
+   private:
+    pointer current_ = nullptr;
+  };
+
+  EDEPTrajectoryChildren(T* first, T* last) : first_(first), last_(last) {};
+
+  iterator begin() const { return iterator(first_); };
+  iterator end() const { return iterator(last_); };
+  bool empty() const { return first_ == last_; };
+  std::size_t size() const { return std::distance(begin(), end()); };
+  T& front() const { return *first_; };
+
+ private:
+  T* first_;
+  T* last_;
+};
+
+/**
+ * @brief First descendant of this trajectory: the first of its arena if it owns one, otherwise the next trajectory of
+ *        the arena holding it.
+ */
+inline const EDEPTrajectory* EDEPTrajectory::DescendantsBegin() const {
+  return arena_.empty() ? this + 1 : arena_.data();
+}
+
+/**
+ * @brief End of the descendants of this trajectory, subtree_size_ positions after it in the arena holding it.
+ */
+inline const EDEPTrajectory* EDEPTrajectory::DescendantsEnd() const {
+  return arena_.empty() ? this + subtree_size_ : arena_.data() + arena_.size();
+}
+
+inline EDEPTrajectoryChildren<EDEPTrajectory> EDEPTrajectory::GetChildrenTrajectories() {
+  return {const_cast<EDEPTrajectory*>(DescendantsBegin()), const_cast<EDEPTrajectory*>(DescendantsEnd())};
+}
+
+inline EDEPTrajectoryChildren<const EDEPTrajectory> EDEPTrajectory::GetChildrenTrajectories() const {
+  return {DescendantsBegin(), DescendantsEnd()};
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <edep_reader/EDEPUtils.h>
+
 #include <TG4Event.h>
 #include <common/sand.h>
 
@@ -22,6 +24,16 @@ class EDEPTrajectoryPoint {
       process_(trajectory_hit.GetProcess()),
       sub_process_(trajectory_hit.GetSubprocess()) {};
 
+  /**
+   * @brief Constructor for EDEPTrajectoryPoint.
+   * @param position Position of the trajectory point.
+   * @param momentum Momentum of the trajectory point.
+   * @param process Process associated with the trajectory point.
+   * @param sub_process Subprocess associated with the trajectory point.
+   */
+  EDEPTrajectoryPoint(sand::vec_4d position, sand::mom_3d momentum, int process, int sub_process)
+    : position_(position), momentum_(momentum), process_(process), sub_process_(sub_process) {};
+
   /**
    * @brief Destructor for EDEPTrajectoryPoint.
    */
@@ -63,4 +75,4 @@ class EDEPTrajectoryPoint {
   int sub_process_;         ///< Subprocess associated with the trajectory point.
 };
 
-using EDEPTrajectoryPoints = std::map<component, std::vector<EDEPTrajectoryPoint>>;
+using EDEPTrajectoryPoints = EDEPComponentMap<std::vector<EDEPTrajectoryPoint>>;
@@ -1,144 +1,364 @@
 #include "EDEPTree.h"
 
-// Iterators
+#include <ufw/context.hpp>
+
+#include <common/utils/worker_pool.h>
+#include <root_tgeomanager/root_tgeomanager.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+  /**
+   * @brief Calls task(i) for each i in [0, n), on the threads of the pool if any, otherwise on the calling thread.
+   */
+  template <typename Task>
+  void ParallelFor(std::size_t n, sand::utils::worker_pool* workers, Task&& task) {
+    if (workers != nullptr) {
+      workers->parallel_for(n, std::forward<Task>(task));
+      return;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      task(i);
+    }
+  }
+
+} // namespace
+
+/**
+ * @brief Constructor for the EDEPTree class.
+ * @details Initializes the tree with default values.
+ */
+EDEPTree::EDEPTree() {
+  this->SetId(-1);
+  this->SetParent(nullptr);
+  this->SetDepth(-1);
+}
 
 /**
- * @brief Constructor for iterator class.
- * @param parent_trj Pointer to the parent trajectory.
- * @param child_it Iterator pointing to a child trajectory.
+ * @brief Copy constructor for the EDEPTree class.
+ * @param tree The EDEPTree object to copy.
  */
-EDEPTree::iterator::iterator(value_type* parent_trj, child_iterator child_it) {
-  this->current_it_ = child_it;
-  this->parent_trj_ = parent_trj;
+EDEPTree::EDEPTree(const EDEPTree& tree)
+  : EDEPTrajectory(tree, node_copy_tag{}), trajectory_index_(tree.trajectory_index_), hit_index_(tree.hit_index_) {
+  arena_.reserve(tree.arena_.size());
+  for (const auto& trj : tree.arena_) {
+    arena_.emplace_back(trj, node_copy_tag{});
+  }
+  LinkArena();
 }
 
 /**
- * @brief Prefix increment operator for the iterator class.
- * @details Increments the iterator to the next trajectory in the tree.
- * @return Reference to the updated iterator.
+ * @brief Move constructor for the EDEPTree class.
+ * @param tree The EDEPTree object to move, left empty.
  */
-EDEPTree::iterator& EDEPTree::iterator::operator++ () {
-  if (!current_it_->GetChildrenTrajectories().empty()) {
-    parent_trj_ = &(*current_it_);
-    current_it_ = current_it_->GetChildrenTrajectories().begin();
+EDEPTree::EDEPTree(EDEPTree&& tree) noexcept
+  : EDEPTrajectory(std::move(tree)),
+    trajectory_index_(std::move(tree.trajectory_index_)),
+    hit_index_(std::move(tree.hit_index_)) {
+  tree.arena_.clear();
+  tree.trajectory_index_.clear();
+  tree.hit_index_.clear();
+}
 
-  } else {
-    ++current_it_;
-    while (parent_trj_ && (current_it_ == parent_trj_->GetChildrenTrajectories().end())) {
-      auto grand_parent = parent_trj_->GetParent();
-      if (!grand_parent) {
-        current_it_ = parent_trj_->GetChildrenTrajectories().end();
-        parent_trj_ = nullptr;
-        break;
-      }
+/**
+ * @brief Copy assignment operator for the EDEPTree class.
+ * @param tree The EDEPTree object to copy.
+ * @return Reference to the copied EDEPTree object.
+ */
+EDEPTree& EDEPTree::operator= (const EDEPTree& tree) {
+  EDEPTree copy(tree);
+  return *this = std::move(copy);
+}
 
-      auto b = grand_parent->GetChildrenTrajectories().begin();
+/**
+ * @brief Move assignment operator for the EDEPTree class.
+ * @param tree The EDEPTree object to move, left empty.
+ * @return Reference to the moved EDEPTree object.
+ */
+EDEPTree& EDEPTree::operator= (EDEPTree&& tree) noexcept {
+  EDEPTrajectory::operator= (std::move(tree));
+  trajectory_index_ = std::move(tree.trajectory_index_);
+  hit_index_        = std::move(tree.hit_index_);
+  tree.arena_.clear();
+  tree.trajectory_index_.clear();
+  tree.hit_index_.clear();
+  return *this;
+}
+
+/**
+ * @brief Creates the tree structure from a vector of trajectories.
+ * @details Trajectories are grouped by parent ID and moved depth-first into the arena, so the build is linear in the
+ *          number of trajectories. Siblings keep the order they have in the input vector, and trajectories whose
+ *          parent is not part of the input are dropped.
+ * @param trajectories_vect Vector of trajectories.
+ */
+void EDEPTree::CreateTree(std::vector<EDEPTrajectory> trajectories_vect) {
+  std::unordered_map<int, std::vector<std::size_t>> children_of;
+  for (std::size_t i = 0; i < trajectories_vect.size(); ++i) {
+    children_of[trajectories_vect[i].GetParentId()].push_back(i);
+  }
 
-      // syntax for doing parent_trj_ + 1
-      ptrdiff_t diff = parent_trj_ - &(*b); // granted by std::vector
+  arena_.clear();
+  arena_.reserve(trajectories_vect.size());
+  trajectory_index_.clear();
+  trajectory_index_.reserve(trajectories_vect.size());
 
-      parent_trj_ = grand_parent;
-      current_it_ = b + diff + 1;
+  auto primaries = children_of.find(this->GetId());
+  if (primaries != children_of.end()) {
+    for (auto position : primaries->second) {
+      AppendSubtree(trajectories_vect, position, arena_.max_size(), children_of);
     }
   }
-
-  return *this;
+  IndexHits();
 }
 
 /**
- * @brief Constructor for const_iterator class.
- * @param parent_trj Pointer to the parent trajectory.
- * @param child_it Iterator pointing to a child trajectory.
+ * @brief Moves a trajectory and, recursively, its children at the end of the arena.
+ * @param trajectories_vect Vector of trajectories the tree is being built from.
+ * @param position Position of the trajectory in trajectories_vect.
+ * @param parent Position of the parent in the arena, or arena_.max_size() for the primaries.
+ * @param children_of Positions in trajectories_vect of the children of each trajectory ID.
  */
-EDEPTree::const_iterator::const_iterator(value_type* parent_trj, const_child_iterator child_it) {
-  this->current_it_ = child_it;
-  this->parent_trj_ = parent_trj;
+void EDEPTree::AppendSubtree(std::vector<EDEPTrajectory>& trajectories_vect, std::size_t position, std::size_t parent,
+                             const std::unordered_map<int, std::vector<std::size_t>>& children_of) {
+  int trj_id = trajectories_vect[position].GetId();
+  if (!trajectory_index_.emplace(trj_id, arena_.size()).second) {
+    return;
+  }
+
+  const bool primary = parent == arena_.max_size();
+  std::size_t first  = arena_.size();
+  arena_.push_back(std::move(trajectories_vect[position]));
+  arena_[first].parent_offset_ = primary ? 0 : first - parent;
+  arena_[first].owner_         = primary ? this : nullptr;
+  arena_[first].depth_         = (primary ? this->GetDepth() : arena_[parent].GetDepth()) + 1;
+  auto children                = children_of.find(trj_id);
+  if (children != children_of.end()) {
+    for (auto child_position : children->second) {
+      AppendSubtree(trajectories_vect, child_position, first, children_of);
+    }
+  }
+  arena_[first].subtree_size_ = arena_.size() - first;
 }
 
 /**
- * @brief Prefix increment operator for the const_iterator class.
- * @details Increments the const_iterator to the next trajectory in the tree.
- * @return Reference to the updated const_iterator.
+ * @brief Updates the ID index of the trajectories from a position to the end of the arena, after they moved.
+ * @param first Position of the first trajectory which moved.
  */
-EDEPTree::const_iterator& EDEPTree::const_iterator::operator++ () {
-  if (!current_it_->GetChildrenTrajectories().empty()) {
-    parent_trj_ = &(*current_it_);
-    current_it_ = current_it_->GetChildrenTrajectories().begin();
+void EDEPTree::IndexTrajectoriesFrom(std::size_t first) {
+  for (auto i = first; i < arena_.size(); ++i) {
+    trajectory_index_[arena_[i].GetId()] = i;
+  }
+}
 
-  } else {
-    ++current_it_;
-    while (parent_trj_ && (current_it_ == parent_trj_->GetChildrenTrajectories().end())) {
-      auto grand_parent = parent_trj_->GetParent();
-      if (!grand_parent) {
-        current_it_ = parent_trj_->GetChildrenTrajectories().end();
-        parent_trj_ = nullptr;
-        break;
+/**
+ * @brief Updates the parent offsets spanning a position of the arena, before trajectories are inserted or removed
+ *        there.
+ * @details Offsets are relative, so the only ones changing are those of the children of @p parent and of its
+ *          ancestors which come after the edited position. Subtrees moving as a whole keep theirs.
+ * @param parent The trajectory whose subtree is edited, or nullptr for the tree itself.
+ * @param position Position of the first trajectory after the edit which stays in the arena.
+ * @param shift By how many positions these trajectories move.
+ */
+void EDEPTree::ShiftLaterSiblings(EDEPTrajectory* parent, std::size_t position, std::ptrdiff_t shift) {
+  for (auto p = parent; p != nullptr; p = p->ArenaParent()) {
+    for (auto& child : p->GetChildrenTrajectories()) {
+      if (static_cast<std::size_t>(&child - arena_.data()) >= position) {
+        child.parent_offset_ += shift;
       }
+    }
+  }
+}
 
-      auto b = grand_parent->GetChildrenTrajectories().begin();
-
-      // syntax for doing parent_trj_ + 1
-      ptrdiff_t diff = parent_trj_ - &(*b); // granted by std::vector
-
-      parent_trj_ = grand_parent;
-      current_it_ = b + diff + 1;
+/**
+ * @brief Rebuilds the tables locating each hit from its component and ID.
+ * @details Each table spans the IDs of one component, which are contiguous for trees built from an EDepSim event.
+ *          If an ID appears more than once in a component, the first hit in depth-first order is kept. Later edits of
+ *          the tree only add or remove the hits of the trajectories they move in or out.
+ */
+void EDEPTree::IndexHits() {
+  hit_index_.clear();
+  std::map<component, std::pair<int, int>> id_ranges;
+  for (const auto& trj : arena_) {
+    for (const auto& hits : trj.GetHitMap()) {
+      for (const auto& hit : hits.second) {
+        if (hit.GetId() < 0) {
+          continue;
+        }
+        auto range = id_ranges.emplace(hits.first, std::make_pair(hit.GetId(), hit.GetId())).first;
+        range->second.first  = std::min(range->second.first, hit.GetId());
+        range->second.second = std::max(range->second.second, hit.GetId());
+      }
     }
   }
+  for (const auto& range : id_ranges) {
+    auto& table    = hit_index_[range.first];
+    table.first_id = range.second.first;
+    table.locations.resize(range.second.second - range.second.first + 1);
+  }
 
-  return *this;
+  for (std::size_t i = 0; i < arena_.size(); ++i) {
+    for (const auto& hits : arena_[i].GetHitMap()) {
+      for (std::size_t j = 0; j < hits.second.size(); ++j) {
+        int id = hits.second[j].GetId();
+        if (id < 0) {
+          continue;
+        }
+        auto& table    = hit_index_[hits.first];
+        auto& location = table.locations[id - table.first_id];
+        if (location.hit < 0) {
+          location = {arena_[i].GetId(), static_cast<int>(j)};
+        }
+      }
+    }
+  }
 }
 
 /**
- * @brief Constructor for the EDEPTree class.
- * @details Initializes the tree with default values.
+ * @brief Adds the hits of a trajectory, which must already be in the ID index, to the hit tables.
+ * @details Tables grow to cover IDs outside their span. A hit already in the tables is replaced only if the new
+ *          trajectory comes first in depth-first order.
+ * @param trj The trajectory whose hits are added.
  */
-EDEPTree::EDEPTree() {
-  this->SetId(-1);
-  this->SetParent(nullptr);
-  this->SetDepth(-1);
+void EDEPTree::IndexHitsOf(const EDEPTrajectory& trj) {
+  const auto position = trajectory_index_.at(trj.GetId());
+  for (const auto& hits : trj.GetHitMap()) {
+    for (std::size_t j = 0; j < hits.second.size(); ++j) {
+      int id = hits.second[j].GetId();
+      if (id < 0) {
+        continue;
+      }
+      auto& table = hit_index_[hits.first];
+      if (table.locations.empty()) {
+        table.first_id = id;
+      } else if (id < table.first_id) {
+        table.locations.insert(table.locations.begin(), table.first_id - id, hit_location{});
+        table.first_id = id;
+      }
+      std::size_t offset = id - table.first_id;
+      if (offset >= table.locations.size()) {
+        table.locations.resize(offset + 1);
+      }
+      auto& location = table.locations[offset];
+      if (location.hit < 0 || trajectory_index_.at(location.trajectory) > position) {
+        location = {trj.GetId(), static_cast<int>(j)};
+      }
+    }
+  }
 }
 
 /**
- * @brief Creates the tree structure from a vector of trajectories.
- * @param trajectories_vect Vector of trajectories.
+ * @brief Removes the hits of a trajectory from the hit tables.
+ * @param trj The trajectory whose hits are removed.
  */
-void EDEPTree::CreateTree(const std::vector<EDEPTrajectory>& trajectories_vect) {
-  bool complete = true;
-  while (complete) {
-    complete = true;
-    for (auto it = trajectories_vect.begin(); it != trajectories_vect.end(); it++) {
-      if (!HasTrajectory((*it).GetId())) {
-        complete  = false;
-        int depth = 0;
-        AddTrajectory((*it));
+void EDEPTree::UnindexHitsOf(const EDEPTrajectory& trj) {
+  for (const auto& hits : trj.GetHitMap()) {
+    for (std::size_t j = 0; j < hits.second.size(); ++j) {
+      auto location = FindHit(hits.second[j].GetId(), hits.first);
+      if (location && location->trajectory == trj.GetId() && location->hit == static_cast<int>(j)) {
+        *const_cast<hit_location*>(location) = {};
       }
     }
   }
-  std::for_each(this->begin(), this->end(), [](EDEPTrajectory& trj) { trj.ComputeDepth(); });
+}
+
+/**
+ * @brief Looks up a hit in the hit tables.
+ * @param id ID of the hit.
+ * @param component_name Name of the detector component.
+ * @return Location of the hit, or nullptr if no trajectory of the tree holds it.
+ */
+const EDEPTree::hit_location* EDEPTree::FindHit(int id, component component_name) const {
+  auto table = hit_index_.find(component_name);
+  if (table == hit_index_.end() || id < table->second.first_id) {
+    return nullptr;
+  }
+  std::size_t position = id - table->second.first_id;
+  if (position >= table->second.locations.size() || table->second.locations[position].hit < 0) {
+    return nullptr;
+  }
+  return &table->second.locations[position];
 }
 
 /**
  * @brief Initializes the tree from a TG4Event
+ * @details Hits are numbered across all the segment detectors of the event, in the order of SegmentDetectors, so
+ *          that the hit ID is also the truth index of the segment. Skipped components keep their share of the
+ *          numbering.
+ *
+ *          With a pool of workers, the hits are bucketed by track in chunks which are merged back in their original
+ *          order, and the trajectories are built, points classification included, by the threads of the pool each
+ *          with its own geometry navigator. The tree is then assembled on the calling thread, so the result is the
+ *          same for any number of threads.
  * @param edep_event TG4Event object.
+ * @param components Components whose hits are read, all of them if empty.
+ * @param trajectory_points Whether the trajectory points are classified into components.
+ * @param workers Threads building the tree along with the calling one, which alone builds it if nullptr. Workers
+ *                which navigated the geometry must release their navigator before they end.
+ * @param geometry Geometry of the trajectory points, taken from the current context if nullptr. It must be given
+ *                 when the calling thread has no current context.
  */
-void EDEPTree::InizializeFromEdep(const TG4Event& edep_event) {
-  this->GetChildrenTrajectories().clear();
-  std::map<int, std::map<component, std::vector<EDEPHit>>> hit_map;
-  for (auto hmap : edep_event.SegmentDetectors) {
-    for (uint i = 0; i < hmap.second.size(); i++) {
-      auto h = hmap.second[i];
-      if(string_to_component.find(hmap.first) == string_to_component.end()) {
- 	hit_map[h.Contrib[0]][component::OTHER].push_back(EDEPHit(h, i));
+void EDEPTree::InizializeFromEdep(const TG4Event& edep_event, const std::set<component>& components,
+                                  bool trajectory_points, sand::utils::worker_pool* workers,
+                                  sand::root_tgeomanager* geometry) {
+  const std::size_t threads = workers != nullptr ? workers->size() : 1;
+
+  struct hit_chunk {
+    component comp;
+    const TG4HitSegment* segments;
+    std::size_t size;
+    int first_id;
+    std::map<int, EDEPHitsMap> hits;
+  };
+  std::vector<hit_chunk> chunks;
+  int hit_id = 0;
+  for (const auto& hmap : edep_event.SegmentDetectors) {
+    auto comp_it = string_to_component.find(hmap.first);
+    auto comp    = comp_it == string_to_component.end() ? component::OTHER : comp_it->second;
+    auto size    = hmap.second.size();
+    if (components.empty() || components.count(comp) != 0) {
+      auto chunk_size = std::max<std::size_t>((size + threads - 1) / threads, 1);
+      for (std::size_t begin = 0; begin < size; begin += chunk_size) {
+        chunks.push_back({comp, hmap.second.data() + begin, std::min(chunk_size, size - begin),
+                          hit_id + static_cast<int>(begin), {}});
+      }
+    }
+    hit_id += size;
+  }
+  ParallelFor(chunks.size(), workers, [&chunks](std::size_t c) {
+    auto& chunk = chunks[c];
+    for (std::size_t i = 0; i < chunk.size; ++i) {
+      const auto& h = chunk.segments[i];
+      chunk.hits[h.Contrib[0]][chunk.comp].push_back(EDEPHit(h, chunk.first_id + static_cast<int>(i)));
+    }
+  });
+  std::map<int, EDEPHitsMap> hit_map;
+  for (auto& chunk : chunks) {
+    for (auto& [track, track_hits] : chunk.hits) {
+      auto& hits = track_hits[chunk.comp];
+      auto& dest = hit_map[track][chunk.comp];
+      if (dest.empty()) {
+        dest = std::move(hits);
       } else {
-     	 hit_map[h.Contrib[0]][string_to_component[hmap.first]].push_back(EDEPHit(h, i));
+        dest.insert(dest.end(), std::make_move_iterator(hits.begin()), std::make_move_iterator(hits.end()));
       }
     }
   }
-  std::vector<EDEPTrajectory> trajectories;
-  for (auto trj : edep_event.Trajectories) {
-    trajectories.push_back(EDEPTrajectory(trj, hit_map, edep_event.Primaries));
+
+  if (threads > 1 && trajectory_points) {
+    if (geometry == nullptr) {
+      geometry = &ufw::context::current()->instance<sand::root_tgeomanager>();
+    }
+    geometry->set_max_threads(threads);
   }
-  CreateTree(trajectories);
+  std::vector<EDEPTrajectory> trajectories(edep_event.Trajectories.size());
+  ParallelFor(trajectories.size(), workers, [&](std::size_t i) {
+    trajectories[i] =
+        EDEPTrajectory(edep_event.Trajectories[i], hit_map, edep_event.Primaries, trajectory_points, geometry);
+  });
+  CreateTree(std::move(trajectories));
 }
 
 /**
@@ -146,39 +366,52 @@ void EDEPTree::InizializeFromEdep(const TG4Event& edep_event) {
  * @param trajectories_vect Vector of trajectories.
  */
 void EDEPTree::InizializeFromTrj(const std::vector<EDEPTrajectory>& trajectories_vect) {
-  this->GetChildrenTrajectories().clear();
-  CreateTree(trajectories_vect);
+  // The tree is built from the parent IDs alone, the descendants carried by copies are not needed.
+  std::vector<EDEPTrajectory> trajectories;
+  trajectories.reserve(trajectories_vect.size());
+  for (const auto& trj : trajectories_vect) {
+    trajectories.emplace_back(trj, node_copy_tag{});
+  }
+  CreateTree(std::move(trajectories));
 }
 
 /**
- * @brief Adds a trajectory to the tree.
+ * @brief Adds a trajectory to the tree, as the last child of its parent.
+ * @details The descendants of the trajectory are added with it. Nothing is added if the parent is not in the tree or
+ *          if the tree already has a trajectory with the same ID.
  * @param trajectory The trajectory to add.
  */
 void EDEPTree::AddTrajectory(const EDEPTrajectory& trajectory) {
   int parent_id = trajectory.GetParentId();
+  if (HasTrajectory(trajectory.GetId())) {
+    return;
+  }
   if (parent_id == -1) {
-    this->AddChild(trajectory);
-  } else {
-    std::find_if(this->begin(), this->end(), [parent_id](const EDEPTrajectory& trj) {
-      return parent_id == trj.GetId();
-    })->AddChild(trajectory);
+    InsertSubtree(this, CopySubtree(trajectory));
+  } else if (auto parent = FindTrajectory(parent_id)) {
+    InsertSubtree(parent, CopySubtree(trajectory));
   }
 }
 
 /**
  * @brief Adds a trajectory to the tree at a specified position.
+ * @details The descendants of the trajectory are added with it. Nothing is added if the parent is not in the subtree
+ *          or if the tree already has a trajectory with the same ID.
  * @param trajectory The trajectory to add.
  * @param it Iterator pointing to the position where the trajectory should be added.
  */
 void EDEPTree::AddTrajectoryTo(const EDEPTrajectory& trajectory, iterator it) {
   int parent_id = trajectory.GetParentId();
+  if (HasTrajectory(trajectory.GetId())) {
+    return;
+  }
   if (parent_id == -1) {
-    this->AddChild(trajectory);
+    InsertSubtree(this, CopySubtree(trajectory));
   } else {
-    EDEPTree::iterator end_it = GetTrajectoryEnd(it);
-    std::find_if(it, end_it, [parent_id](const EDEPTrajectory& trj) {
-      return parent_id == trj.GetId();
-    })->AddChild(trajectory);
+    auto parent = FindTrajectory(parent_id);
+    if (IsInSubtree(parent, it->Get())) {
+      InsertSubtree(parent, CopySubtree(trajectory));
+    }
   }
 }
 
@@ -186,25 +419,40 @@ void EDEPTree::AddTrajectoryTo(const EDEPTrajectory& trajectory, iterator it) {
  * @brief Removes a trajectory from the tree.
  * @param trj_id ID of the trajectory to remove.
  */
-void EDEPTree::RemoveTrajectory(int trj_id) { GetParentOf(trj_id)->RemoveChildWithId(trj_id); }
+void EDEPTree::RemoveTrajectory(int trj_id) {
+  if (auto trj = FindTrajectory(trj_id)) {
+    ExtractSubtree(trj);
+  }
+}
 
 /**
  * @brief Removes a trajectory from the tree at a specified position.
  * @param trj_id ID of the trajectory to remove.
  * @param it Iterator pointing to the position of the trajectory to remove.
  */
-void EDEPTree::RemoveTrajectoryFrom(int trj_id, iterator it) { GetParentOf(trj_id, it)->RemoveChildWithId(trj_id); }
+void EDEPTree::RemoveTrajectoryFrom(int trj_id, iterator it) {
+  auto trj = FindTrajectory(trj_id);
+  if (trj && IsInSubtree(trj->GetParent(), it->Get())) {
+    ExtractSubtree(trj);
+  }
+}
 
 /**
  * @brief Moves a trajectory to a new parent trajectory.
+ * @details The subtree of the trajectory is taken out of the arena and becomes the last child of the new parent.
+ *          Nothing happens if the new parent is in the subtree.
  * @param id_to_move ID of the trajectory to move.
  * @param next_parent_id ID of the new parent trajectory.
  */
 void EDEPTree::MoveTrajectoryTo(int id_to_move, int next_parent_id) {
-  EDEPTrajectory trjToMove = *GetTrajectory(id_to_move);
-  RemoveTrajectory(id_to_move);
-  GetTrajectory(next_parent_id)->AddChild(trjToMove);
-  std::for_each(this->begin(), this->end(), [](EDEPTrajectory& trj) { trj.ComputeDepth(); });
+  auto trj         = FindTrajectory(id_to_move);
+  auto next_parent = FindTrajectory(next_parent_id);
+  if (!trj || !next_parent || IsInSubtree(next_parent, trj)) {
+    return;
+  }
+  auto subtree                  = ExtractSubtree(trj);
+  subtree.front().parent_id_    = next_parent_id;
+  InsertSubtree(FindTrajectory(next_parent_id), std::move(subtree));
 }
 
 /**
@@ -212,10 +460,7 @@ void EDEPTree::MoveTrajectoryTo(int id_to_move, int next_parent_id) {
  * @param trj_id ID of the trajectory to check.
  * @return True if the trajectory is found, otherwise false.
  */
-bool EDEPTree::HasTrajectory(int trj_id) const {
-  return std::find_if(this->begin(), this->end(), [trj_id](const EDEPTrajectory& trj) { return trj_id == trj.GetId(); })
-      != this->end();
-}
+bool EDEPTree::HasTrajectory(int trj_id) const { return trajectory_index_.find(trj_id) != trajectory_index_.end(); }
 
 /**
  * @brief Checks if a trajectory is in a specified subtree.
@@ -223,12 +468,7 @@ bool EDEPTree::HasTrajectory(int trj_id) const {
  * @param it Iterator pointing to the subtree.
  * @return True if the trajectory is found in the subtree, otherwise false.
  */
-bool EDEPTree::IsTrajectoryIn(int trj_id, iterator it) {
-  EDEPTree::iterator end_it = GetTrajectoryEnd(it);
-  EDEPTree::iterator found_it =
-      std::find_if(it, end_it, [trj_id](const EDEPTrajectory& trj) { return trj_id == trj.GetId(); });
-  return (found_it != end_it) ? true : false;
-}
+bool EDEPTree::IsTrajectoryIn(int trj_id, iterator it) { return IsInSubtree(FindTrajectory(trj_id), it->Get()); }
 
 /**
  * @brief Checks if a trajectory is in a specified subtree.
@@ -237,42 +477,47 @@ bool EDEPTree::IsTrajectoryIn(int trj_id, iterator it) {
  * @return True if the trajectory is found in the subtree, otherwise false.
  */
 bool EDEPTree::IsTrajectoryIn(int trj_id, const_iterator it) const {
-  EDEPTree::const_iterator end_it = GetTrajectoryEnd(it);
-  EDEPTree::const_iterator found_it =
-      std::find_if(it, end_it, [trj_id](const EDEPTrajectory& trj) { return trj_id == trj.GetId(); });
-  return (found_it != end_it) ? true : false;
+  return IsInSubtree(FindTrajectory(trj_id), it->Get());
+}
+
+/**
+ * @brief Retrieves the trajectory with the given ID.
+ * @param trj_id ID of the trajectory.
+ * @return Iterator pointing to the trajectory, or the end iterator if it is not in the tree.
+ */
+EDEPTree::iterator EDEPTree::GetTrajectory(int trj_id) {
+  auto trj = FindTrajectory(trj_id);
+  return trj ? iterator(trj) : this->end();
+}
+
+/**
+ * @brief Retrieves the trajectory with the given ID.
+ * @param trj_id ID of the trajectory.
+ * @return Const iterator pointing to the trajectory, or the end iterator if it is not in the tree.
+ */
+EDEPTree::const_iterator EDEPTree::GetTrajectory(int trj_id) const {
+  auto trj = FindTrajectory(trj_id);
+  return trj ? const_iterator(trj) : this->end();
 }
 
 /**
  * @brief Retrieves the parent trajectory of a trajectory with the given ID.
  * @param trj_id ID of the trajectory.
- * @return Iterator pointing to the parent trajectory.
+ * @return Iterator pointing to the parent trajectory, or the end iterator for primaries.
  */
 EDEPTree::iterator EDEPTree::GetParentOf(int trj_id) {
-  auto f = [trj_id](const EDEPTrajectory& trj) {
-    for (const auto& t : trj.GetChildrenTrajectories()) {
-      if (trj_id == t.GetId())
-        return true;
-    };
-    return false;
-  };
-  return std::find_if(this->begin(), this->end(), f);
+  auto trj = FindTrajectory(trj_id);
+  return (trj && trj->ArenaParent()) ? iterator(trj->ArenaParent()) : this->end();
 }
 
 /**
  * @brief Retrieves the parent trajectory of a trajectory with the given ID.
  * @param trj_id ID of the trajectory.
- * @return Iterator pointing to the parent trajectory.
+ * @return Iterator pointing to the parent trajectory, or the end iterator for primaries.
  */
 EDEPTree::const_iterator EDEPTree::GetParentOf(int trj_id) const {
-  auto f = [trj_id](const EDEPTrajectory& trj) {
-    for (const auto& t : trj.GetChildrenTrajectories()) {
-      if (trj_id == t.GetId())
-        return true;
-    };
-    return false;
-  };
-  return std::find_if(this->begin(), this->end(), f);
+  auto trj = FindTrajectory(trj_id);
+  return (trj && trj->ArenaParent()) ? const_iterator(trj->ArenaParent()) : this->end();
 }
 
 /**
@@ -282,16 +527,8 @@ EDEPTree::const_iterator EDEPTree::GetParentOf(int trj_id) const {
  * @return Iterator pointing to the parent trajectory.
  */
 EDEPTree::iterator EDEPTree::GetParentOf(int trj_id, iterator it) {
-  EDEPTree::iterator end_it = GetTrajectoryEnd(it);
-  auto f                    = [trj_id](const EDEPTrajectory& trj) {
-    for (const auto& t : trj.GetChildrenTrajectories()) {
-      if (trj_id == t.GetId())
-        return true;
-    };
-    return false;
-  };
-  EDEPTree::iterator found_it = std::find_if(it, end_it, f);
-  return (found_it != end_it) ? found_it : this->end();
+  auto trj = FindTrajectory(trj_id);
+  return (trj && IsInSubtree(trj->GetParent(), it->Get())) ? iterator(trj->GetParent()) : this->end();
 }
 
 /**
@@ -301,16 +538,8 @@ EDEPTree::iterator EDEPTree::GetParentOf(int trj_id, iterator it) {
  * @return Iterator pointing to the parent trajectory.
  */
 EDEPTree::const_iterator EDEPTree::GetParentOf(int tid, const_iterator it) const {
-  EDEPTree::const_iterator end_it = GetTrajectoryEnd(it);
-  auto f                          = [tid](const EDEPTrajectory& trj) {
-    for (const auto& t : trj.GetChildrenTrajectories()) {
-      if (tid == t.GetId())
-        return true;
-    };
-    return false;
-  };
-  EDEPTree::const_iterator found_it = std::find_if(it, end_it, f);
-  return (found_it != end_it) ? found_it : this->end();
+  auto trj = FindTrajectory(tid);
+  return (trj && IsInSubtree(trj->GetParent(), it->Get())) ? const_iterator(trj->GetParent()) : this->end();
 }
 
 /**
@@ -320,10 +549,8 @@ EDEPTree::const_iterator EDEPTree::GetParentOf(int tid, const_iterator it) const
  * @return Iterator pointing to the trajectory with the given ID.
  */
 EDEPTree::iterator EDEPTree::GetTrajectoryFrom(int trj_id, iterator it) {
-  EDEPTree::iterator end_it = GetTrajectoryEnd(it);
-  EDEPTree::iterator found_it =
-      std::find_if(it, end_it, [trj_id](const EDEPTrajectory& trj) { return trj_id == trj.GetId(); });
-  return (found_it != end_it) ? found_it : end_it;
+  auto trj = FindTrajectory(trj_id);
+  return IsInSubtree(trj, it->Get()) ? iterator(trj) : GetTrajectoryEnd(it);
 }
 
 /**
@@ -333,40 +560,46 @@ EDEPTree::iterator EDEPTree::GetTrajectoryFrom(int trj_id, iterator it) {
  * @return Iterator pointing to the trajectory with the given ID.
  */
 EDEPTree::const_iterator EDEPTree::GetTrajectoryFrom(int trj_id, const_iterator it) const {
-  EDEPTree::const_iterator end_it = GetTrajectoryEnd(it);
-  EDEPTree::const_iterator found_it =
-      std::find_if(it, end_it, [trj_id](const EDEPTrajectory& trj) { return trj_id == trj.GetId(); });
-  return (found_it != end_it) ? found_it : this->end();
+  auto trj = FindTrajectory(trj_id);
+  return IsInSubtree(trj, it->Get()) ? const_iterator(trj) : this->end();
 }
 
 /**
  * @brief Returns an iterator to the trajectory containing a hit with the specified ID.
  *
- * This function searches through the tree for a trajectory that contains a hit
- * with the given ID and returns an iterator to the matching trajectory.
+ * Hit IDs are unique in trees built from an EDepSim event. Otherwise, if several components have a hit
+ * with this ID, the first trajectory in depth-first order holding one of them is returned.
  *
  * @param id The ID of the hit to search for.
  * @return An iterator to the trajectory containing the hit, or the end iterator if no match is found.
  */
 EDEPTree::iterator EDEPTree::GetTrajectoryWithHitId(int id) {
-  EDEPTree::iterator found_it =
-      std::find_if(this->begin(), this->end(), [id](const EDEPTrajectory& trj) { return trj.HasHitWithId(id); });
-  return (found_it != this->end()) ? found_it : this->end();
+  auto found_it = this->end();
+  for (const auto& locations : hit_index_) {
+    if (auto location = FindHit(id, locations.first)) {
+      found_it = std::min(found_it, iterator(FindTrajectory(location->trajectory)));
+    }
+  }
+  return found_it;
 }
 
 /**
  * @brief Returns a const iterator to the trajectory containing a hit with the specified ID.
  *
- * This function searches through the tree for a trajectory that contains a hit
- * with the given ID and returns a const iterator to the matching trajectory.
+ * Hit IDs are unique in trees built from an EDepSim event. Otherwise, if several components have a hit
+ * with this ID, the first trajectory in depth-first order holding one of them is returned.
  *
  * @param id The ID of the hit to search for.
  * @return A const iterator to the trajectory containing the hit, or the end iterator if no match is found.
  */
 EDEPTree::const_iterator EDEPTree::GetTrajectoryWithHitId(int id) const {
-  EDEPTree::const_iterator found_it =
-      std::find_if(this->begin(), this->end(), [id](const EDEPTrajectory& trj) { return trj.HasHitWithId(id); });
-  return (found_it != this->end()) ? found_it : this->end();
+  auto found_it = this->end();
+  for (const auto& locations : hit_index_) {
+    if (auto location = FindHit(id, locations.first)) {
+      found_it = std::min(found_it, const_iterator(FindTrajectory(location->trajectory)));
+    }
+  }
+  return found_it;
 }
 
 /**
@@ -377,11 +610,8 @@ EDEPTree::const_iterator EDEPTree::GetTrajectoryWithHitId(int id) const {
  * @return Iterator pointing to the trajectory containing the hit.
  */
 EDEPTree::iterator EDEPTree::GetTrajectoryWithHitIdInDetector(int id, component component_name) {
-  EDEPTree::iterator found_it =
-      std::find_if(this->begin(), this->end(), [id, component_name](const EDEPTrajectory& trj) {
-        return trj.HasHitWithIdInDetector(id, component_name);
-      });
-  return (found_it != this->end()) ? found_it : this->end();
+  auto location = FindHit(id, component_name);
+  return location ? iterator(FindTrajectory(location->trajectory)) : this->end();
 }
 
 /**
@@ -392,11 +622,19 @@ EDEPTree::iterator EDEPTree::GetTrajectoryWithHitIdInDetector(int id, component
  * @return Iterator pointing to the trajectory containing the hit.
  */
 EDEPTree::const_iterator EDEPTree::GetTrajectoryWithHitIdInDetector(int id, component component_name) const {
-  EDEPTree::const_iterator found_it =
-      std::find_if(this->begin(), this->end(), [id, component_name](const EDEPTrajectory& trj) {
-        return trj.HasHitWithIdInDetector(id, component_name);
-      });
-  return (found_it != this->end()) ? found_it : this->end();
+  auto location = FindHit(id, component_name);
+  return location ? const_iterator(FindTrajectory(location->trajectory)) : this->end();
+}
+
+/**
+ * @brief Retrieves the hit with the given ID in the specified detector component.
+ * @param id ID of the hit, i.e. its truth index in the EDepSim event.
+ * @param component_name Name of the detector component.
+ * @return Pointer to the hit, or nullptr if no trajectory of the tree holds it.
+ */
+const EDEPHit* EDEPTree::GetHitWithIdInDetector(int id, component component_name) const {
+  auto location = FindHit(id, component_name);
+  return location ? &FindTrajectory(location->trajectory)->GetHitMap().at(component_name)[location->hit] : nullptr;
 }
 
 /**
@@ -404,15 +642,7 @@ EDEPTree::const_iterator EDEPTree::GetTrajectoryWithHitIdInDetector(int id, comp
  * @param start Iterator pointing to the start of the subtree.
  * @return Iterator pointing to the end of the subtree.
  */
-EDEPTree::iterator EDEPTree::GetTrajectoryEnd(iterator start) {
-  EDEPTree::iterator end_it = start;
-  if (!start->GetChildrenTrajectories().empty()) {
-    end_it = ++iterator(start->Get(), --(start->GetChildrenTrajectories().end()));
-  } else {
-    end_it = ++start;
-  }
-  return end_it;
-}
+EDEPTree::iterator EDEPTree::GetTrajectoryEnd(iterator start) { return start + start->GetSubtreeSize(); }
 
 /**
  * @brief Retrieves the iterator to the end of the subtree starting from the specified iterator position.
@@ -420,11 +650,128 @@ EDEPTree::iterator EDEPTree::GetTrajectoryEnd(iterator start) {
  * @return Iterator pointing to the end of the subtree.
  */
 EDEPTree::const_iterator EDEPTree::GetTrajectoryEnd(const_iterator start) const {
-  EDEPTree::const_iterator end_it = start;
-  if (!start->GetChildrenTrajectories().empty()) {
-    end_it = ++const_iterator(start->Get(), --(start->GetChildrenTrajectories().end()));
-  } else {
-    end_it = ++start;
+  return start + start->GetSubtreeSize();
+}
+
+/**
+ * @brief Looks up a trajectory in the ID index.
+ * @param trj_id ID of the trajectory.
+ * @return Pointer to the trajectory, or nullptr if it is not in the tree.
+ */
+EDEPTrajectory* EDEPTree::FindTrajectory(int trj_id) {
+  auto found = trajectory_index_.find(trj_id);
+  return (found != trajectory_index_.end()) ? &arena_[found->second] : nullptr;
+}
+
+/**
+ * @brief Looks up a trajectory in the ID index.
+ * @param trj_id ID of the trajectory.
+ * @return Const pointer to the trajectory, or nullptr if it is not in the tree.
+ */
+const EDEPTrajectory* EDEPTree::FindTrajectory(int trj_id) const {
+  auto found = trajectory_index_.find(trj_id);
+  return (found != trajectory_index_.end()) ? &arena_[found->second] : nullptr;
+}
+
+/**
+ * @brief Checks if a trajectory belongs to the subtree rooted in another one.
+ * @param trj The trajectory to check, may be nullptr or the tree itself.
+ * @param subtree The root of the subtree, a trajectory of the arena.
+ * @return True if trj is subtree itself or one of its descendants.
+ */
+bool EDEPTree::IsInSubtree(const EDEPTrajectory* trj, const EDEPTrajectory* subtree) const {
+  return trj != nullptr && trj != this && trj >= subtree && trj < subtree + subtree->subtree_size_;
+}
+
+/**
+ * @brief Position in the arena where the subtree of a trajectory ends.
+ * @param trj A trajectory of the arena, or the tree itself.
+ * @return The position following the last descendant of trj.
+ */
+std::size_t EDEPTree::SubtreeEndOf(const EDEPTrajectory* trj) const {
+  return (trj == this) ? arena_.size() : (trj - arena_.data()) + trj->subtree_size_;
+}
+
+/**
+ * @brief Copies a trajectory and its descendants, in depth-first order, for insertion in the arena.
+ * @param trj The trajectory to copy, part of a tree or a copy.
+ * @return The copies. The parent offsets within the subtree are set, the one of its root on insertion.
+ */
+std::vector<EDEPTrajectory> EDEPTree::CopySubtree(const EDEPTrajectory& trj) {
+  std::vector<EDEPTrajectory> subtree;
+  subtree.reserve(trj.DescendantsEnd() - trj.DescendantsBegin() + 1);
+  subtree.emplace_back(trj, node_copy_tag{});
+  for (auto descendant = trj.DescendantsBegin(); descendant != trj.DescendantsEnd(); ++descendant) {
+    subtree.emplace_back(*descendant, node_copy_tag{});
+  }
+  subtree.front().subtree_size_ = subtree.size();
+  // The children of a copy are the first trajectories of its own arena, here they follow it.
+  for (auto& child : subtree.front().GetChildrenTrajectories()) {
+    child.parent_offset_ = &child - &subtree.front();
+  }
+  return subtree;
+}
+
+/**
+ * @brief Inserts a subtree, stored in depth-first order, as the last child of a node.
+ * @details The trajectories after the insertion point move, but only the children of the ancestors among them get a
+ *          new parent offset. Their positions are updated in the ID index and the hits of the new trajectories are
+ *          indexed.
+ * @param parent The node receiving the subtree, a trajectory of the arena or the tree itself.
+ * @param subtree The trajectories to insert, with their subtree sizes and their parent offsets but the first one.
+ */
+void EDEPTree::InsertSubtree(EDEPTrajectory* parent, std::vector<EDEPTrajectory> subtree) {
+  const std::size_t count    = subtree.size();
+  const std::size_t position = SubtreeEndOf(parent);
+  if (parent == this) {
+    parent = nullptr;
+  }
+  ShiftLaterSiblings(parent, position, count);
+  for (auto p = parent; p != nullptr; p = p->ArenaParent()) {
+    p->subtree_size_ += count;
+  }
+
+  auto& root           = subtree.front();
+  const int depth      = (parent ? parent->GetDepth() : this->GetDepth()) + 1 - root.GetDepth();
+  root.parent_offset_  = parent ? position - (parent - arena_.data()) : 0;
+  for (auto& trj : subtree) {
+    trj.depth_ += depth;
   }
-  return end_it;
+  arena_.insert(arena_.begin() + position, std::make_move_iterator(subtree.begin()),
+                std::make_move_iterator(subtree.end()));
+  arena_[position].owner_ = parent ? nullptr : this;
+
+  IndexTrajectoriesFrom(position);
+  for (std::size_t i = position; i < position + count; ++i) {
+    IndexHitsOf(arena_[i]);
+  }
+}
+
+/**
+ * @brief Removes a trajectory, with its subtree, from the arena.
+ * @details The trajectories after the subtree move back, only the children of the ancestors among them get a new
+ *          parent offset. Their positions are updated in the ID index and the hits of the removed trajectories are
+ *          dropped from the tables.
+ * @param trj The trajectory to remove.
+ * @return The removed trajectories, in depth-first order.
+ */
+std::vector<EDEPTrajectory> EDEPTree::ExtractSubtree(EDEPTrajectory* trj) {
+  const std::size_t count    = trj->subtree_size_;
+  const std::size_t position = trj - arena_.data();
+  auto parent                = trj->ArenaParent();
+  ShiftLaterSiblings(parent, position + count, -static_cast<std::ptrdiff_t>(count));
+  for (auto p = parent; p != nullptr; p = p->ArenaParent()) {
+    p->subtree_size_ -= count;
+  }
+  for (auto t = trj; t != trj + count; ++t) {
+    UnindexHitsOf(*t);
+    trajectory_index_.erase(t->GetId());
+  }
+
+  auto first = arena_.begin() + position;
+  std::vector<EDEPTrajectory> subtree(std::make_move_iterator(first), std::make_move_iterator(first + count));
+  arena_.erase(first, first + count);
+
+  IndexTrajectoriesFrom(position);
+  return subtree;
 }
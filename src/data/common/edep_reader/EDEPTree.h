@@ -2,7 +2,12 @@
 
 #include <edep_reader/EDEPTrajectory.h>
 
-// Binary search not implemented due to low counts of child elements
+#include <set>
+#include <unordered_map>
+
+namespace sand::utils {
+  class worker_pool;
+}
 
 /**
  * @class EDEPTree
@@ -11,103 +16,98 @@
  * This class extends EDEPTrajectory to organize trajectories in a tree structure.
  * It provides iterators for traversing the tree, as well as functions for adding,
  * removing, and manipulating trajectories within the tree.
+ *
+ * All the trajectories are stored depth-first in a single contiguous arena: the subtree of a trajectory is the span
+ * starting at its position and as long as its subtree size, so traversing the tree is a linear scan. The first child
+ * of a trajectory is the next one, and its parent is found a stored number of positions before it. The tree itself is
+ * not part of the arena and is the parent of the primary trajectories. No link depends on where the arena is in
+ * memory, so growing, copying or moving the tree does not touch the trajectories.
  */
 class EDEPTree : public EDEPTrajectory {
  public:
   // Iterators
-  typedef std::vector<EDEPTrajectory>::iterator child_iterator;
 
   /**
-   * @class iterator
-   * @brief Iterator for traversing the tree.
+   * @class tree_iterator
+   * @brief Iterator for traversing the tree in depth-first order.
    */
-  class iterator {
+  template <typename T>
+  class tree_iterator {
    public:
-    typedef EDEPTrajectory value_type;
-    typedef std::forward_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::random_access_iterator_tag iterator_category;
     typedef ptrdiff_t difference_type;
     typedef value_type* pointer;
     typedef value_type& reference;
 
-    iterator() = default;
-
-    reference operator* () { return *current_it_; };
-    pointer operator->() { return &(*current_it_); };
-    bool operator== (const iterator& it) {
-      return (this->parent_trj_ == it.parent_trj_ && this->current_it_ == it.current_it_);
+    tree_iterator() = default;
+
+    reference operator* () const { return *current_; };
+    pointer operator->() const { return current_; };
+    reference operator[] (difference_type n) const { return current_[n]; };
+    bool operator== (const tree_iterator& it) const { return current_ == it.current_; };
+    bool operator!= (const tree_iterator& it) const { return current_ != it.current_; };
+    bool operator< (const tree_iterator& it) const { return current_ < it.current_; };
+    bool operator> (const tree_iterator& it) const { return current_ > it.current_; };
+    bool operator<= (const tree_iterator& it) const { return current_ <= it.current_; };
+    bool operator>= (const tree_iterator& it) const { return current_ >= it.current_; };
+    tree_iterator& operator++ () {
+      ++current_;
+      return *this;
+    }; // ++it
+    tree_iterator operator++ (int) { return tree_iterator(current_++); }; // it++
+    tree_iterator& operator-- () {
+      --current_;
+      return *this;
+    }; // --it
+    tree_iterator operator-- (int) { return tree_iterator(current_--); }; // it--
+    tree_iterator& operator+= (difference_type n) {
+      current_ += n;
+      return *this;
     };
-    bool operator!= (const iterator& it) {
-      return (this->parent_trj_ != it.parent_trj_ || this->current_it_ != it.current_it_);
+    tree_iterator& operator-= (difference_type n) {
+      current_ -= n;
+      return *this;
     };
-    iterator& operator++ (); //++it
-    iterator operator++ (int) {
-      iterator tmpIt = *this;
-      ++*this;
-      return tmpIt;
-    }; // it++
-    // iterator& operator -- (); //--it
-    // iterator  operator -- (int); //it--
+    tree_iterator operator+ (difference_type n) const { return tree_iterator(current_ + n); };
+    tree_iterator operator- (difference_type n) const { return tree_iterator(current_ - n); };
+    difference_type operator- (const tree_iterator& it) const { return current_ - it.current_; };
+    friend tree_iterator operator+ (difference_type n, const tree_iterator& it) { return it + n; };
 
    private:
-    iterator(pointer parent_trj_, child_iterator child_it);
+    explicit tree_iterator(pointer trj) : current_(trj) {};
 
-    pointer parent_trj_ = nullptr;
-    child_iterator current_it_;
+    pointer current_ = nullptr;
 
     friend class EDEPTree;
   };
 
-  typedef std::vector<EDEPTrajectory>::const_iterator const_child_iterator;
-
-  /**
-   * @class const_iterator
-   * @brief Const iterator for traversing the tree.
-   */
-  class const_iterator {
-   public:
-    typedef const EDEPTrajectory value_type;
-    typedef std::forward_iterator_tag iterator_category;
-    typedef ptrdiff_t difference_type;
-    typedef value_type* pointer;
-    typedef value_type& reference;
-
-    const_iterator() = default;
-    reference operator* () { return *current_it_; };
-    pointer operator->() { return &(*current_it_); };
-    bool operator== (const const_iterator& it) {
-      return (this->parent_trj_ == it.parent_trj_ && this->current_it_ == it.current_it_);
-    };
-    bool operator!= (const const_iterator& it) {
-      return (this->parent_trj_ != it.parent_trj_ || this->current_it_ != it.current_it_);
-    };
-    const_iterator& operator++ (); //++it
-    const_iterator operator++ (int) {
-      const_iterator tmpIt = *this;
-      ++*this;
-      return tmpIt;
-    }; // it++
-    // const_iterator& operator -- (); //--it
-    // const_iterator  operator -- (int); //it--
-
-   private:
-    const_iterator(pointer parent_trj_, const_child_iterator child_it);
-
-    pointer parent_trj_ = nullptr;
-    const_child_iterator current_it_;
-
-    friend class EDEPTree;
-  };
+  typedef tree_iterator<EDEPTrajectory> iterator;
+  typedef tree_iterator<const EDEPTrajectory> const_iterator;
 
   // Constructor
   EDEPTree();
+  EDEPTree(const EDEPTree& tree);
+  EDEPTree(EDEPTree&& tree) noexcept;
+
+  EDEPTree& operator= (const EDEPTree& tree);
+  EDEPTree& operator= (EDEPTree&& tree) noexcept;
 
   // Functions
-  iterator begin() { return iterator(nullptr, this->GetChildrenTrajectories().begin()); }
-  const_iterator begin() const { return const_iterator(nullptr, this->GetChildrenTrajectories().begin()); }
-  iterator end() { return iterator(nullptr, this->GetChildrenTrajectories().end()); }
-  const_iterator end() const { return const_iterator(nullptr, this->GetChildrenTrajectories().end()); }
+  iterator begin() { return iterator(arena_.data()); }
+  const_iterator begin() const { return const_iterator(arena_.data()); }
+  iterator end() { return iterator(arena_.data() + arena_.size()); }
+  const_iterator end() const { return const_iterator(arena_.data() + arena_.size()); }
+
+  /**
+   * @brief Get the number of trajectories in the tree.
+   * @return The number of trajectories.
+   */
+  std::size_t size() const { return arena_.size(); }
 
-  void InizializeFromEdep(const TG4Event& edep_event);
+  void InizializeFromEdep(const TG4Event& edep_event, const std::set<component>& components = {},
+                          bool trajectory_points = true, sand::utils::worker_pool* workers = nullptr,
+                          sand::root_tgeomanager* geometry = nullptr);
   void InizializeFromTrj(const std::vector<EDEPTrajectory>& trajectories_vect);
 
   void AddTrajectory(const EDEPTrajectory& trajectory);
@@ -121,14 +121,8 @@ class EDEPTree : public EDEPTrajectory {
   bool IsTrajectoryIn(int trj_id, iterator it);
   bool IsTrajectoryIn(int trj_id, const_iterator it) const;
 
-  iterator GetTrajectory(int trj_id) {
-    return std::find_if(this->begin(), this->end(),
-                        [trj_id](const EDEPTrajectory& trj) { return trj_id == trj.GetId(); });
-  }
-  const_iterator GetTrajectory(int trj_id) const {
-    return std::find_if(this->begin(), this->end(),
-                        [trj_id](const EDEPTrajectory& trj) { return trj_id == trj.GetId(); });
-  }
+  iterator GetTrajectory(int trj_id);
+  const_iterator GetTrajectory(int trj_id) const;
 
   iterator GetParentOf(int trj_id);
   const_iterator GetParentOf(int trj_id) const;
@@ -147,6 +141,8 @@ class EDEPTree : public EDEPTrajectory {
   iterator GetTrajectoryWithHitIdInDetector(int id, component component_name);
   const_iterator GetTrajectoryWithHitIdInDetector(int id, component component_name) const;
 
+  const EDEPHit* GetHitWithIdInDetector(int id, component component_name) const;
+
   /**
    * @brief Filter trajectories based on a custom predicate and copy the results to an output iterator.
    *
@@ -186,5 +182,41 @@ class EDEPTree : public EDEPTrajectory {
   }
 
  private:
-  void CreateTree(const std::vector<EDEPTrajectory>& trajectories_vect);
+  friend class sand::edep_cache::reader;
+
+  /// Location of a hit: the ID of the trajectory holding it and its index among the trajectory hits in the
+  /// component. A negative hit index marks IDs without a hit. Trajectory IDs, unlike positions, do not change when the
+  /// arena is edited.
+  struct hit_location {
+    int trajectory = -1;
+    int hit        = -1;
+  };
+
+  /// Locations of the hits of a component, indexed by hit ID minus the smallest ID of the component.
+  struct hit_table {
+    int first_id = 0;
+    std::vector<hit_location> locations;
+  };
+
+  void CreateTree(std::vector<EDEPTrajectory> trajectories_vect);
+  void AppendSubtree(std::vector<EDEPTrajectory>& trajectories_vect, std::size_t position, std::size_t parent,
+                     const std::unordered_map<int, std::vector<std::size_t>>& children_of);
+  void IndexTrajectoriesFrom(std::size_t first);
+  void ShiftLaterSiblings(EDEPTrajectory* parent, std::size_t position, std::ptrdiff_t shift);
+  void IndexHits();
+  void IndexHitsOf(const EDEPTrajectory& trj);
+  void UnindexHitsOf(const EDEPTrajectory& trj);
+  const hit_location* FindHit(int id, component component_name) const;
+
+  EDEPTrajectory* FindTrajectory(int trj_id);
+  const EDEPTrajectory* FindTrajectory(int trj_id) const;
+  bool IsInSubtree(const EDEPTrajectory* trj, const EDEPTrajectory* subtree) const;
+  std::size_t SubtreeEndOf(const EDEPTrajectory* trj) const;
+
+  static std::vector<EDEPTrajectory> CopySubtree(const EDEPTrajectory& trj);
+  void InsertSubtree(EDEPTrajectory* parent, std::vector<EDEPTrajectory> subtree);
+  std::vector<EDEPTrajectory> ExtractSubtree(EDEPTrajectory* trj);
+
+  std::unordered_map<int, std::size_t> trajectory_index_; ///< Trajectory ID to position in the arena.
+  EDEPComponentMap<hit_table> hit_index_;                 ///< Location of each hit, by component and hit ID.
 };
@@ -1,8 +1,15 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <initializer_list>
+#include <iterator>
 #include <map>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <utility>
 
 /// \file
 
@@ -21,3 +28,160 @@ extern std::initializer_list<std::string> drift_names;
 extern std::initializer_list<std::string> ecal_names;
 extern std::initializer_list<std::string> magnet_names;
 extern std::initializer_list<std::string> world_names;
+
+/**
+ * @class EDEPComponentMap
+ * @brief Map from detector components to values, stored in a fixed array indexed by the component.
+ *
+ * It has the interface of the std::map it replaces: only the components which have been inserted are found and
+ * visited, in component order. Which components are present is kept in a bit mask, so lookups cost a bit test.
+ */
+template <typename T>
+class EDEPComponentMap {
+ public:
+  typedef component key_type;
+  typedef T mapped_type;
+  typedef std::pair<component, T> value_type;
+
+  /// Number of components, hence of slots in the map.
+  static constexpr std::size_t slots = static_cast<std::size_t>(component::OTHER) + 1;
+
+  /**
+   * @class basic_iterator
+   * @brief Bidirectional iterator over the components present in the map.
+   */
+  template <typename V>
+  class basic_iterator {
+   public:
+    typedef V value_type;
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef ptrdiff_t difference_type;
+    typedef value_type* pointer;
+    typedef value_type& reference;
+
+    basic_iterator() = default;
+    basic_iterator(pointer slots, std::uint8_t present, std::size_t index)
+      : slots_(slots), present_(present), index_(index) {};
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, V*>>>
+    basic_iterator(const basic_iterator<U>& it) : slots_(it.slots_), present_(it.present_), index_(it.index_) {};
+
+    reference operator* () const { return slots_[index_]; };
+    pointer operator->() const { return slots_ + index_; };
+    bool operator== (const basic_iterator& it) const { return index_ == it.index_ && slots_ == it.slots_; };
+    bool operator!= (const basic_iterator& it) const { return !(*this == it); };
+    basic_iterator& operator++ () {
+      do {
+        ++index_;
+      } while (index_ < slots && !(present_ & (1 << index_)));
+      return *this;
+    }; // ++it
+    basic_iterator operator++ (int) {
+      basic_iterator tmpIt = *this;
+      ++*this;
+      return tmpIt;
+    }; // it++
+    basic_iterator& operator-- () {
+      do {
+        --index_;
+      } while (index_ > 0 && !(present_ & (1 << index_)));
+      return *this;
+    }; // --it
+    basic_iterator operator-- (int) {
+      basic_iterator tmpIt = *this;
+      --*this;
+      return tmpIt;
+    }; // it--
+
+   private:
+    pointer slots_        = nullptr;
+    std::uint8_t present_ = 0;
+    std::size_t index_    = 0;
+
+    template <typename U>
+    friend class basic_iterator;
+  };
+
+  typedef basic_iterator<value_type> iterator;
+  typedef basic_iterator<const value_type> const_iterator;
+  typedef std::reverse_iterator<iterator> reverse_iterator;
+  typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+  EDEPComponentMap() {
+    for (std::size_t i = 0; i < slots; ++i) {
+      slots_[i].first = static_cast<component>(i);
+    }
+  };
+
+  iterator begin() { return iterator(slots_.data(), present_, First()); };
+  const_iterator begin() const { return const_iterator(slots_.data(), present_, First()); };
+  iterator end() { return iterator(slots_.data(), present_, slots); };
+  const_iterator end() const { return const_iterator(slots_.data(), present_, slots); };
+  reverse_iterator rbegin() { return reverse_iterator(end()); };
+  const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); };
+  reverse_iterator rend() { return reverse_iterator(begin()); };
+  const_reverse_iterator rend() const { return const_reverse_iterator(begin()); };
+
+  bool empty() const { return present_ == 0; };
+  std::size_t size() const { return __builtin_popcount(present_); };
+  std::size_t count(component comp) const { return Has(comp) ? 1 : 0; };
+
+  iterator find(component comp) { return Has(comp) ? iterator(slots_.data(), present_, Index(comp)) : end(); };
+  const_iterator find(component comp) const {
+    return Has(comp) ? const_iterator(slots_.data(), present_, Index(comp)) : end();
+  };
+
+  T& at(component comp) {
+    if (!Has(comp)) {
+      throw std::out_of_range("EDEPComponentMap::at");
+    }
+    return slots_[Index(comp)].second;
+  };
+  const T& at(component comp) const {
+    if (!Has(comp)) {
+      throw std::out_of_range("EDEPComponentMap::at");
+    }
+    return slots_[Index(comp)].second;
+  };
+
+  T& operator[] (component comp) {
+    present_ |= 1 << Index(comp);
+    return slots_[Index(comp)].second;
+  };
+
+  std::size_t erase(component comp) {
+    if (!Has(comp)) {
+      return 0;
+    }
+    present_ &= ~(1 << Index(comp));
+    slots_[Index(comp)].second = T();
+    return 1;
+  };
+
+  void clear() {
+    for (auto& slot : slots_) {
+      slot.second = T();
+    }
+    present_ = 0;
+  };
+
+  bool operator== (const EDEPComponentMap& map) const {
+    if (present_ != map.present_) {
+      return false;
+    }
+    for (std::size_t i = 0; i < slots; ++i) {
+      if ((present_ & (1 << i)) && !(slots_[i].second == map.slots_[i].second)) {
+        return false;
+      }
+    }
+    return true;
+  };
+  bool operator!= (const EDEPComponentMap& map) const { return !(*this == map); };
+
+ private:
+  static std::size_t Index(component comp) { return static_cast<std::size_t>(comp); };
+  bool Has(component comp) const { return present_ & (1 << Index(comp)); };
+  std::size_t First() const { return present_ == 0 ? slots : __builtin_ctz(present_); };
+
+  std::array<value_type, slots> slots_; ///< Value of each component, meaningful only if present.
+  std::uint8_t present_ = 0;            ///< Bit mask of the components present in the map.
+};
@@ -0,0 +1,376 @@
+#include <ufw/context.hpp>
+#include <ufw/data.hpp>
+
+#include <edep_reader/edep_cache.hpp>
+
+#include <cstring>
+#include <type_traits>
+
+namespace sand::edep_cache {
+
+  namespace {
+
+    constexpr char s_magic[8]                = {'S', 'A', 'N', 'D', 'E', 'D', 'E', 'P'};
+    constexpr std::uint32_t s_version        = 1;
+    constexpr std::size_t s_index_ptr_offset = sizeof(s_magic) + 2 * sizeof(std::uint32_t);
+    constexpr std::size_t s_header_size      = s_index_ptr_offset + sizeof(std::uint64_t);
+
+    template <typename T>
+    void put(std::ostream& os, T value) {
+      static_assert(std::is_arithmetic_v<T>);
+      os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void put(std::ostream& os, const vec_4d& v) {
+      put(os, v.X());
+      put(os, v.Y());
+      put(os, v.Z());
+      put(os, v.T());
+    }
+
+    void put(std::ostream& os, const mom_3d& v) {
+      put(os, v.X());
+      put(os, v.Y());
+      put(os, v.Z());
+    }
+
+    void put(std::ostream& os, const TLorentzVector& v) {
+      put(os, v.X());
+      put(os, v.Y());
+      put(os, v.Z());
+      put(os, v.T());
+    }
+
+    void put(std::ostream& os, const std::string& s) {
+      put<std::uint32_t>(os, s.size());
+      os.write(s.data(), s.size());
+    }
+
+    void put(std::ostream& os, const TG4HitSegment& segment) {
+      put<std::int32_t>(os, segment.GetPrimaryId());
+      put<double>(os, segment.GetEnergyDeposit());
+      put<double>(os, segment.GetSecondaryDeposit());
+      put<double>(os, segment.GetTrackLength());
+      put(os, segment.GetStart());
+      put(os, segment.GetStop());
+      put<std::uint32_t>(os, segment.Contrib.size());
+      for (int contrib : segment.Contrib) {
+        put<std::int32_t>(os, contrib);
+      }
+    }
+
+    void put(std::ostream& os, const EDEPHitsMap& hits) {
+      put<std::uint32_t>(os, hits.size());
+      for (const auto& [comp, comp_hits] : hits) {
+        put<std::int32_t>(os, static_cast<std::int32_t>(comp));
+        put<std::uint64_t>(os, comp_hits.size());
+        for (const auto& hit : comp_hits) {
+          put(os, hit.GetStart());
+          put(os, hit.GetStop());
+          put(os, hit.GetEnergyDeposit());
+          put(os, hit.GetSecondaryDeposit());
+          put(os, hit.GetTrackLength());
+          put<std::int32_t>(os, hit.GetContrib());
+          put<std::int32_t>(os, hit.GetPrimaryId());
+          put<std::int32_t>(os, hit.GetId());
+        }
+      }
+    }
+
+    void put(std::ostream& os, const EDEPTrajectoryPoints& points) {
+      put<std::uint32_t>(os, points.size());
+      for (const auto& [comp, comp_points] : points) {
+        put<std::int32_t>(os, static_cast<std::int32_t>(comp));
+        put<std::uint64_t>(os, comp_points.size());
+        for (const auto& point : comp_points) {
+          put(os, point.GetPosition());
+          put(os, point.GetMomentum());
+          put<std::int32_t>(os, point.GetProcess());
+          put<std::int32_t>(os, point.GetSubprocess());
+        }
+      }
+    }
+
+    void put(std::ostream& os, const EDEPComponentMap<bool>& flags) {
+      put<std::uint32_t>(os, flags.size());
+      for (const auto& [comp, flag] : flags) {
+        put<std::int32_t>(os, static_cast<std::int32_t>(comp));
+        put<std::uint8_t>(os, flag);
+      }
+    }
+
+    /// Bounds checked reader over a span of the file, loaded in memory.
+    class cursor {
+     public:
+      cursor(const char* begin, const char* end) : m_pos(begin), m_end(end) {}
+
+      template <typename T>
+      T get() {
+        static_assert(std::is_arithmetic_v<T>);
+        check(sizeof(T));
+        T value;
+        std::memcpy(&value, m_pos, sizeof(T));
+        m_pos += sizeof(T);
+        return value;
+      }
+
+      /// Reads the size of a sequence whose elements take at least min_size bytes each.
+      template <typename T>
+      std::size_t get_count(std::size_t min_size) {
+        std::size_t n = get<T>();
+        if (n > static_cast<std::size_t>(m_end - m_pos) / min_size) {
+          UFW_ERROR("Truncated edep cache record.");
+        }
+        return n;
+      }
+
+      vec_4d get_vec_4d() {
+        double x = get<double>();
+        double y = get<double>();
+        double z = get<double>();
+        double t = get<double>();
+        return vec_4d(x, y, z, t);
+      }
+
+      mom_3d get_mom_3d() {
+        double x = get<double>();
+        double y = get<double>();
+        double z = get<double>();
+        return mom_3d(x, y, z);
+      }
+
+      TLorentzVector get_lorentz_vector() {
+        auto v = get_vec_4d();
+        return TLorentzVector(v.X(), v.Y(), v.Z(), v.T());
+      }
+
+      std::string get_string() {
+        std::size_t n = get_count<std::uint32_t>(1);
+        std::string s(m_pos, n);
+        m_pos += n;
+        return s;
+      }
+
+      void get(TG4HitSegment& segment) {
+        segment.PrimaryId        = get<std::int32_t>();
+        segment.EnergyDeposit    = get<double>();
+        segment.SecondaryDeposit = get<double>();
+        segment.TrackLength      = get<double>();
+        segment.Start            = get_lorentz_vector();
+        segment.Stop             = get_lorentz_vector();
+        segment.Contrib.resize(get_count<std::uint32_t>(sizeof(std::int32_t)));
+        for (auto& contrib : segment.Contrib) {
+          contrib = get<std::int32_t>();
+        }
+      }
+
+      void get(EDEPHitsMap& hits) {
+        for (std::size_t n = get<std::uint32_t>(); n != 0; --n) {
+          auto& comp_hits = hits[get_component()];
+          std::size_t n_hits = get_count<std::uint64_t>(11 * sizeof(double) + 3 * sizeof(std::int32_t));
+          comp_hits.reserve(n_hits);
+          for (; n_hits != 0; --n_hits) {
+            auto start            = get_vec_4d();
+            auto stop             = get_vec_4d();
+            double energy_deposit = get<double>();
+            double secondary      = get<double>();
+            double track_length   = get<double>();
+            int contrib           = get<std::int32_t>();
+            int primary_id        = get<std::int32_t>();
+            int id                = get<std::int32_t>();
+            comp_hits.emplace_back(start, stop, energy_deposit, secondary, track_length, contrib, primary_id, id);
+          }
+        }
+      }
+
+      void get(EDEPTrajectoryPoints& points) {
+        for (std::size_t n = get<std::uint32_t>(); n != 0; --n) {
+          auto& comp_points = points[get_component()];
+          std::size_t n_points = get_count<std::uint64_t>(7 * sizeof(double) + 2 * sizeof(std::int32_t));
+          comp_points.reserve(n_points);
+          for (; n_points != 0; --n_points) {
+            auto position   = get_vec_4d();
+            auto momentum   = get_mom_3d();
+            int process     = get<std::int32_t>();
+            int sub_process = get<std::int32_t>();
+            comp_points.emplace_back(position, momentum, process, sub_process);
+          }
+        }
+      }
+
+      void get(EDEPComponentMap<bool>& flags) {
+        for (std::size_t n = get<std::uint32_t>(); n != 0; --n) {
+          auto comp   = get_component();
+          flags[comp] = get<std::uint8_t>() != 0;
+        }
+      }
+
+     private:
+      component get_component() {
+        auto comp = get<std::int32_t>();
+        if (comp < 0 || comp > static_cast<std::int32_t>(component::OTHER)) {
+          UFW_ERROR("Invalid component {} in edep cache record.", comp);
+        }
+        return static_cast<component>(comp);
+      }
+
+      void check(std::size_t size) const {
+        if (static_cast<std::size_t>(m_end - m_pos) < size) {
+          UFW_ERROR("Truncated edep cache record.");
+        }
+      }
+
+      const char* m_pos;
+      const char* m_end;
+    };
+
+  } // namespace
+
+  writer::writer(const std::string& path) : m_path(path), m_file(path, std::ios::binary | std::ios::trunc) {
+    if (!m_file) {
+      UFW_ERROR("Cannot open edep cache '{}' for writing.", path);
+    }
+    m_file.write(s_magic, sizeof(s_magic));
+    put(m_file, s_version);
+    put<std::uint32_t>(m_file, 0);
+    put<std::uint64_t>(m_file, 0); // offset of the index, set when closing the file
+  }
+
+  writer::~writer() {
+    std::uint64_t index_offset = m_file.tellp();
+    put<std::uint64_t>(m_file, m_index.size());
+    for (const auto& [id, record] : m_index) {
+      put(m_file, id);
+      put(m_file, record.offset);
+      put(m_file, record.size);
+    }
+    m_file.seekp(s_index_ptr_offset);
+    put(m_file, index_offset);
+    m_file.close();
+    if (!m_file) {
+      UFW_WARN("Could not finalize edep cache '{}', the file is incomplete.", m_path);
+    }
+  }
+
+  /**
+   * Appends the record of a context. The segments are the ones of the whole event, which the hit IDs refer to.
+   */
+  void writer::write(ufw::context_id id, const EDEPTree& tree, const std::vector<const TG4HitSegment*>& segments) {
+    entry record{static_cast<std::uint64_t>(m_file.tellp()), 0};
+    put<std::uint64_t>(m_file, segments.size());
+    for (const auto* segment : segments) {
+      put(m_file, *segment);
+    }
+    put<std::uint64_t>(m_file, tree.size());
+    for (const auto& trj : tree) {
+      put<std::int32_t>(m_file, trj.id_);
+      put<std::int32_t>(m_file, trj.parent_id_);
+      put<std::int32_t>(m_file, trj.pdg_code_);
+      put<std::int32_t>(m_file, trj.interaction_number_);
+      put(m_file, trj.p0_);
+      put(m_file, trj.reaction_);
+      put(m_file, trj.hit_map_);
+      put(m_file, trj.trajectory_points_);
+      put(m_file, trj.first_points_);
+      put(m_file, trj.last_points_);
+      put(m_file, trj.entering_map_);
+      put(m_file, trj.exiting_map_);
+    }
+    record.size = static_cast<std::uint64_t>(m_file.tellp()) - record.offset;
+    if (!m_file) {
+      UFW_ERROR("Cannot write context {} to edep cache '{}'.", id, m_path);
+    }
+    m_index.emplace_back(static_cast<std::int64_t>(id), record);
+  }
+
+  reader::reader(const std::string& path) : m_path(path), m_file(path, std::ios::binary | std::ios::ate) {
+    if (!m_file) {
+      UFW_ERROR("Cannot open edep cache '{}'.", path);
+    }
+    m_size = m_file.tellg();
+    if (m_size < s_header_size) {
+      UFW_ERROR("'{}' is not an edep cache.", path);
+    }
+
+    const char* data = load(0, s_header_size);
+    if (std::memcmp(data, s_magic, sizeof(s_magic)) != 0) {
+      UFW_ERROR("'{}' is not an edep cache.", path);
+    }
+    cursor header(data + sizeof(s_magic), data + s_header_size);
+    auto version = header.get<std::uint32_t>();
+    if (version != s_version) {
+      UFW_ERROR("Edep cache '{}' has version {}, expected {}.", path, version, s_version);
+    }
+    header.get<std::uint32_t>();
+    auto index_offset = header.get<std::uint64_t>();
+    if (index_offset < s_header_size || index_offset > m_size) {
+      UFW_ERROR("Edep cache '{}' is incomplete.", path);
+    }
+
+    data = load(index_offset, m_size - index_offset);
+    cursor index(data, data + (m_size - index_offset));
+    std::size_t n = index.get_count<std::uint64_t>(sizeof(std::int64_t) + sizeof(entry));
+    m_index.reserve(n);
+    for (; n != 0; --n) {
+      auto id     = index.get<std::int64_t>();
+      auto offset = index.get<std::uint64_t>();
+      auto size   = index.get<std::uint64_t>();
+      if (offset < s_header_size || offset > index_offset || size > index_offset - offset) {
+        UFW_ERROR("Edep cache '{}' has a corrupted index.", path);
+      }
+      m_index[id] = {offset, size};
+    }
+  }
+
+  /**
+   * Reads a span of the file into the buffer, which stays valid until the next call.
+   */
+  const char* reader::load(std::uint64_t offset, std::uint64_t size) const {
+    m_buffer.resize(size);
+    m_file.seekg(offset);
+    m_file.read(m_buffer.data(), size);
+    if (!m_file) {
+      m_file.clear();
+      UFW_ERROR("Cannot read {} bytes at offset {} of edep cache '{}'.", size, offset, m_path);
+    }
+    return m_buffer.data();
+  }
+
+  bool reader::contains(ufw::context_id id) const { return m_index.count(static_cast<std::int64_t>(id)) != 0; }
+
+  /**
+   * Decodes the record of a context into a tree and the segments of its event, in truth index order.
+   */
+  void reader::read(ufw::context_id id, EDEPTree& tree, std::vector<TG4HitSegment>& segments) const {
+    auto record = m_index.find(static_cast<std::int64_t>(id));
+    if (record == m_index.end()) {
+      UFW_ERROR("Context {} not found in edep cache '{}'.", id, m_path);
+    }
+    const char* begin = load(record->second.offset, record->second.size);
+    cursor in(begin, begin + record->second.size);
+
+    segments.clear();
+    segments.resize(in.get_count<std::uint64_t>(4 * sizeof(double) + 2 * sizeof(std::uint32_t)));
+    for (auto& segment : segments) {
+      in.get(segment);
+    }
+
+    std::vector<EDEPTrajectory> trajectories(in.get_count<std::uint64_t>(8 * sizeof(std::int32_t)));
+    for (auto& trj : trajectories) {
+      trj.id_                 = in.get<std::int32_t>();
+      trj.parent_id_          = in.get<std::int32_t>();
+      trj.pdg_code_           = in.get<std::int32_t>();
+      trj.interaction_number_ = in.get<std::int32_t>();
+      trj.p0_                 = in.get_vec_4d();
+      trj.reaction_           = in.get_string();
+      in.get(trj.hit_map_);
+      in.get(trj.trajectory_points_);
+      in.get(trj.first_points_);
+      in.get(trj.last_points_);
+      in.get(trj.entering_map_);
+      in.get(trj.exiting_map_);
+    }
+    tree.CreateTree(std::move(trajectories));
+  }
+
+} // namespace sand::edep_cache
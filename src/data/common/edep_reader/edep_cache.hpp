@@ -0,0 +1,70 @@
+#pragma once
+
+#include <edep_reader/EDEPTree.h>
+
+#include <ufw/data.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sand::edep_cache {
+
+  /// Location of the record of a context in a cache file.
+  struct entry {
+    std::uint64_t offset;
+    std::uint64_t size;
+  };
+
+  /**
+   * Writes decoded spills to a binary cache file, one record per context.
+   *
+   * A record holds the hit segments of the event, in truth index order, and the trajectories of the tree in depth-first
+   * order with their hits, points and component crossings. The file is a header, the records and an index of the
+   * contexts, written when the writer is destroyed. Values are stored in native byte order and positions are offsets
+   * from the start of the file.
+   */
+  class writer {
+   public:
+    explicit writer(const std::string& path);
+    ~writer();
+
+    writer(const writer&)             = delete;
+    writer& operator= (const writer&) = delete;
+
+    void write(ufw::context_id, const EDEPTree&, const std::vector<const TG4HitSegment*>&);
+
+   private:
+    std::string m_path;
+    std::ofstream m_file;
+    std::vector<std::pair<std::int64_t, entry>> m_index;
+  };
+
+  /**
+   * Reads the spills of a binary cache file. Each record is read with an ordinary file read into a buffer reused from
+   * one context to the next, then decoded into a tree and segments: no ROOT I/O nor geometry lookup is involved.
+   */
+  class reader {
+   public:
+    explicit reader(const std::string& path);
+
+    reader(const reader&)             = delete;
+    reader& operator= (const reader&) = delete;
+
+    std::size_t size() const { return m_index.size(); }
+    bool contains(ufw::context_id) const;
+    void read(ufw::context_id, EDEPTree&, std::vector<TG4HitSegment>&) const;
+
+   private:
+    const char* load(std::uint64_t offset, std::uint64_t size) const;
+
+    std::string m_path;
+    mutable std::ifstream m_file;
+    mutable std::vector<char> m_buffer; ///< Bytes of the last span read by load().
+    std::uint64_t m_size{0};
+    std::unordered_map<std::int64_t, entry> m_index;
+  };
+
+} // namespace sand::edep_cache
@@ -1,4 +1,5 @@
 #include <TFile.h>
+#include <TROOT.h>
 #include <TTree.h>
 
 #include <ufw/config.hpp>
@@ -6,36 +7,225 @@
 #include <ufw/data.hpp>
 
 #include <edep_reader/edep_reader.hpp>
+#include <root_tgeomanager/root_tgeomanager.hpp>
 
 namespace sand {
-  truth_adapter::value_type& truth_adapter::at(const index_type&) { UFW_FATAL("Not yet implemented"); }
+  truth_adapter::value_type& truth_adapter::at(const index_type& i) {
+    const auto& segments = ufw::context::current()->instance<edep_reader>().segments();
+    if (i >= segments.size()) {
+      UFW_ERROR("Truth index {} out of range, the event has {} hit segments.", i, segments.size());
+    }
+    return *segments[i];
+  }
 
-  bool truth_adapter::valid(const index_type&) { UFW_FATAL("Not yet implemented"); }
+  bool truth_adapter::valid(const index_type& i) {
+    return i < ufw::context::current()->instance<edep_reader>().segments().size();
+  }
 
 } // namespace sand
 
-ufw::data::factory<sand::edep_reader>::factory(const ufw::config& cfg) : input_file(nullptr), event(new TG4Event()) {
+ufw::data::factory<sand::edep_reader>::factory(const ufw::config& cfg)
+  : input_file(nullptr),
+    event(new TG4Event()),
+    m_trajectory_points(cfg.value("trajectory_points", true)),
+    m_build_threads(cfg.value("build_threads", std::size_t{1})),
+    m_prefetch_depth(cfg.value("prefetch", std::size_t{0})) {
+  if (!cfg.value("cache", std::string{}).empty()) {
+    auto cache_path = cfg.path_at("cache");
+    m_cache         = std::make_unique<sand::edep_cache::reader>(cache_path.string());
+    UFW_DEBUG("Reading {} decoded spills from cache '{}'.", m_cache->size(), cache_path.c_str());
+    return;
+  }
   auto path = cfg.path_at("uri");
   input_file.reset(TFile::Open(path.c_str()));
   input_tree = input_file->Get<TTree>("EDepSimEvents");
   if (!input_tree) {
     UFW_ERROR("EDepSim tree not found in file '{}'.", path.c_str());
   }
-  TBranch* br = input_tree->GetBranch("Event");
-  if (!br) {
+  input_branch = input_tree->GetBranch("Event");
+  if (!input_branch) {
     UFW_ERROR("EDepSim branch \"Event\" not found in file '{}'.", path.c_str());
   }
-  br->SetAddress(&event);
+  input_branch->SetAddress(&event);
+  for (const auto& name : cfg.value("components", std::vector<std::string>{})) {
+    auto comp = string_to_component.find(name);
+    if (comp == string_to_component.end()) {
+      UFW_ERROR("Unknown EDepSim component '{}'.", name);
+    }
+    m_components.insert(comp->second);
+  }
+  if (m_prefetch_depth > 0 || m_build_threads > 1) {
+    ROOT::EnableThreadSafety();
+  }
+  if (m_prefetch_depth > 0) {
+    UFW_DEBUG("Reading up to {} EDepSim entries ahead.", m_prefetch_depth);
+  }
+  if (m_build_threads > 1) {
+    UFW_DEBUG("Building the EDepSim trees with {} threads.", m_build_threads);
+    m_workers = std::make_unique<sand::utils::worker_pool>(m_build_threads, nullptr, [this] {
+      if (m_geometry != nullptr) {
+        m_geometry->release_navigator();
+      }
+    });
+  }
 }
 
-ufw::data::factory<sand::edep_reader>::~factory() = default;
+ufw::data::factory<sand::edep_reader>::~factory() {
+  stop_prefetch();
+  m_workers.reset();
+}
 
 sand::edep_reader& ufw::data::factory<sand::edep_reader>::instance(ufw::context_id i) {
   if (m_id != i) {
-    input_tree->GetEntry(i);
-    reader.InizializeFromEdep(*event);
-    reader.m_event = event;
-    m_id           = i;
+    if (m_cache) {
+      m_cache->read(i, reader, m_cached_segments);
+      reader.m_segments.clear();
+      for (const auto& segment : m_cached_segments) {
+        reader.m_segments.push_back(&segment);
+      }
+      reader.m_event      = nullptr;
+      reader.m_from_cache = true;
+    } else {
+      if (m_trajectory_points && (m_workers || m_prefetch_depth > 0) && m_geometry == nullptr) {
+        m_geometry = &ufw::context::current()->instance<sand::root_tgeomanager>();
+      }
+      if (m_prefetch_depth > 0) {
+        auto next = wait_for(i);
+        if (m_current_event) {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_free.push_back(std::move(m_current_event));
+        }
+        m_current_event                      = std::move(next.event);
+        static_cast<sand::EDEPTree&>(reader) = std::move(next.tree);
+        reader.m_segments.swap(next.segments);
+        reader.m_event = m_current_event.get();
+      } else {
+        input_tree->GetEntry(i);
+        load(*event, reader, reader.m_segments);
+        reader.m_event = event;
+      }
+    }
+    m_id = i;
   }
   return reader;
 }
+
+/**
+ * Builds the tree of an event and lists its segments. Called by the context thread, or by the prefetch thread which
+ * has no current context and relies on m_geometry.
+ */
+void ufw::data::factory<sand::edep_reader>::load(const TG4Event& edep_event, sand::EDEPTree& tree,
+                                                 std::vector<const TG4HitSegment*>& segments) {
+  // same order as the hit IDs assigned by InizializeFromEdep
+  segments.clear();
+  for (const auto& detector : edep_event.SegmentDetectors) {
+    for (const auto& segment : detector.second) {
+      segments.push_back(&segment);
+    }
+  }
+  tree.InizializeFromEdep(edep_event, m_components, m_trajectory_points, m_workers.get(), m_geometry);
+}
+
+/**
+ * Takes an entry from the prefetch queue, waiting for the prefetch thread to read it. Entries before it are
+ * dropped, the prefetch thread is restarted if the entry is behind or too far ahead of it.
+ */
+ufw::data::factory<sand::edep_reader>::prefetched_entry
+ufw::data::factory<sand::edep_reader>::wait_for(Long64_t entry) {
+  if (entry < 0 || entry >= input_tree->GetEntries()) {
+    UFW_ERROR("Entry {} not found, the EDepSim tree has {} entries.", entry, input_tree->GetEntries());
+  }
+  std::unique_lock<std::mutex> lock(m_mutex);
+  Long64_t first = m_prefetched.empty() ? m_next_entry : m_prefetched.front().entry;
+  if (!m_prefetch_thread.joinable() || entry < first || entry > m_next_entry) {
+    lock.unlock();
+    stop_prefetch();
+    start_prefetch(entry);
+    lock.lock();
+  }
+  while (!m_prefetched.empty() && m_prefetched.front().entry < entry) {
+    m_free.push_back(std::move(m_prefetched.front().event));
+    m_prefetched.pop_front();
+  }
+  m_cv.notify_all();
+  m_cv.wait(lock, [this] { return !m_prefetched.empty() || m_prefetch_error; });
+  if (m_prefetch_error) {
+    std::rethrow_exception(m_prefetch_error);
+  }
+  auto next = std::move(m_prefetched.front());
+  m_prefetched.pop_front();
+  m_cv.notify_all();
+  return next;
+}
+
+void ufw::data::factory<sand::edep_reader>::start_prefetch(Long64_t first_entry) {
+  m_next_entry      = first_entry;
+  m_stop            = false;
+  m_prefetch_error  = nullptr;
+  if (m_geometry != nullptr) {
+    // the prefetch thread navigates along with the context thread and the workers
+    m_geometry->set_max_threads(m_build_threads + 1);
+  }
+  m_prefetch_thread = std::thread([this] {
+    prefetch_loop();
+    if (m_geometry != nullptr) {
+      m_geometry->release_navigator();
+    }
+  });
+}
+
+void ufw::data::factory<sand::edep_reader>::stop_prefetch() {
+  if (!m_prefetch_thread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_cv.notify_all();
+  m_prefetch_thread.join();
+  for (auto& prefetched : m_prefetched) {
+    m_free.push_back(std::move(prefetched.event));
+  }
+  m_prefetched.clear();
+}
+
+/**
+ * Body of the prefetch thread, the only one reading the input tree and building EDEPTrees while prefetching is
+ * active.
+ */
+void ufw::data::factory<sand::edep_reader>::prefetch_loop() {
+  const Long64_t entries = input_tree->GetEntries();
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_cv.wait(lock, [&] { return m_stop || (m_prefetched.size() < m_prefetch_depth && m_next_entry < entries); });
+    if (m_stop) {
+      return;
+    }
+    Long64_t entry = m_next_entry;
+    std::unique_ptr<TG4Event> buffer;
+    if (m_free.empty()) {
+      buffer.reset(new TG4Event());
+    } else {
+      buffer = std::move(m_free.back());
+      m_free.pop_back();
+    }
+    prefetched_entry prefetched{entry, std::move(buffer), {}, {}};
+    lock.unlock();
+    try {
+      event = prefetched.event.get();
+      input_branch->SetAddress(&event);
+      input_tree->GetEntry(entry);
+      load(*prefetched.event, prefetched.tree, prefetched.segments);
+    } catch (...) {
+      lock.lock();
+      m_prefetch_error = std::current_exception();
+      m_cv.notify_all();
+      return;
+    }
+    lock.lock();
+    m_prefetched.push_back(std::move(prefetched));
+    m_next_entry = entry + 1;
+    m_cv.notify_all();
+  }
+}
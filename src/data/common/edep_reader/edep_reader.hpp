@@ -1,13 +1,23 @@
 #pragma once
 
 #include <common/truth.h>
+#include <common/utils/worker_pool.h>
 #include <edep_reader/EDEPTree.h>
+#include <edep_reader/edep_cache.hpp>
 
 #include <ufw/data.hpp>
 
 #include <EDepSim/TG4Event.h>
+#include <RtypesCore.h>
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 class TG4HitSegment;
+class TBranch;
 class TFile;
 class TTree;
 
@@ -17,23 +27,54 @@ namespace sand {
     : public EDEPTree
     , public ufw::data::base<ufw::data::complex_tag, ufw::data::unique_tag, ufw::data::context_tag> {
     TG4Event* m_event{nullptr};
+    std::vector<const TG4HitSegment*> m_segments; ///< All the segments of the event, indexed by truth index.
+    bool m_from_cache{false};                     ///< Whether the spill was decoded from an edep cache file.
 
     using EDEPTree::EDEPTree;
     friend class ufw::data::factory<sand::edep_reader>;
 
    public:
     TG4Event const& event() const {
+      if (m_from_cache) {
+        UFW_ERROR("The EDepSim event is not available when the edep_reader reads from an edep cache, use the tree and "
+                  "segments() instead.");
+      }
       if (m_event != nullptr) {
         return *m_event;
       }
       UFW_ERROR("Event not initialized");
     }
+
+    /// Whether the spill was decoded from an edep cache file, in which case event() is not available.
+    bool from_cache() const { return m_from_cache; }
+
+    /// Segments of the current event in truth index order, the truth index of a segment is also its EDEPHit ID.
+    std::vector<const TG4HitSegment*> const& segments() const { return m_segments; }
   };
 
 } // namespace sand
 
 UFW_DECLARE_COMPLEX_DATA(sand::edep_reader);
 
+/**
+ * Reads the EDepSim events, one entry per context.
+ *
+ * With a non-zero "prefetch" depth a background thread reads, decompresses and builds the tree of the following
+ * entries while the current one is processed. Each entry is built into its own tree, which is moved into the reader
+ * when the context reaches it. The prefetch thread navigates the geometry with its own navigator, released when the
+ * thread ends.
+ *
+ * Jobs using only some subdetectors can list their EDepSim segment detectors in "components" (e.g. ["Straw"]), the
+ * hits of the others are not converted. Setting "trajectory_points" to false skips the classification of the
+ * trajectory points, which costs one geometry lookup per point and is only needed by the true particle info.
+ *
+ * With "build_threads" above 1 the tree of each spill is built by that many threads, each navigating the geometry
+ * with its own navigator. The threads are started once and release their navigators when the reader is destroyed. The
+ * tree is the same as the one built by a single thread.
+ *
+ * If "cache" is set the spills are read from an edep cache file, written by the edep_cache_writer process, instead of
+ * the EDepSim file. No ROOT I/O nor geometry lookup is done then, and event() raises an error.
+ */
 template <>
 class ufw::data::factory<sand::edep_reader> {
  public:
@@ -42,9 +83,45 @@ class ufw::data::factory<sand::edep_reader> {
   sand::edep_reader& instance(ufw::context_id);
 
  private:
+  /// An entry read ahead, and its tree built, by the prefetch thread.
+  struct prefetched_entry {
+    Long64_t entry;
+    std::unique_ptr<TG4Event> event;
+    sand::EDEPTree tree;
+    std::vector<const TG4HitSegment*> segments;
+  };
+
+  void load(const TG4Event&, sand::EDEPTree&, std::vector<const TG4HitSegment*>&);
+  prefetched_entry wait_for(Long64_t entry);
+  void start_prefetch(Long64_t first_entry);
+  void stop_prefetch();
+  void prefetch_loop();
+
   sand::edep_reader reader;
   std::unique_ptr<TFile> input_file;
   TTree* input_tree;
+  TBranch* input_branch;
   TG4Event* event;
   ufw::context_id m_id;
+
+  std::unique_ptr<sand::edep_cache::reader> m_cache;
+  std::vector<TG4HitSegment> m_cached_segments; ///< Segments of the current context when reading from the cache.
+
+  std::set<component> m_components; ///< Components whose hits are read, all of them if empty.
+  bool m_trajectory_points;         ///< Whether trajectory points are classified into components.
+  std::size_t m_build_threads;      ///< Number of threads building the tree of a spill.
+
+  std::unique_ptr<sand::utils::worker_pool> m_workers; ///< Threads building the trees, started once for the job.
+  sand::root_tgeomanager* m_geometry{nullptr};         ///< Geometry navigated by the workers and the prefetch thread.
+
+  std::size_t m_prefetch_depth;                  ///< Number of entries read ahead, 0 disables prefetching.
+  std::unique_ptr<TG4Event> m_current_event;     ///< Event of the current context when prefetching.
+  std::vector<std::unique_ptr<TG4Event>> m_free; ///< Events already processed, reused by the prefetch thread.
+  std::deque<prefetched_entry> m_prefetched;
+  Long64_t m_next_entry = 0;
+  bool m_stop           = false;
+  std::exception_ptr m_prefetch_error;
+  std::thread m_prefetch_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
 };
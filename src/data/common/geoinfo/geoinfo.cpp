@@ -24,6 +24,8 @@ namespace sand {
     auto& tgm = ufw::context::current()->instance<root_tgeomanager>();
 
     auto grain_path = cfg.at("grain_geometry");
+    auto grain_voxel_cache = cfg.value("grain_voxel_cache", std::string{});
+    auto grain_voxel_threads = cfg.value("grain_voxel_threads", std::size_t{1});
     auto drift_view_angle = cfg.value("drift_view_angle", std::array<double, 3>{0.0, -M_PI / 36.0, M_PI / 36.0});
     auto drift_view_offset = cfg.value("drift_view_offset", std::array<double, 3>{10.0, 10.0, 10.0});
     auto drift_view_spacing = cfg.value("drift_view_spacing", std::array<double, 3>{10.0, 10.0, 10.0});
@@ -38,7 +40,7 @@ namespace sand {
 
     UFW_DEBUG("Using root path '{}'.", m_root_path.c_str());
 
-    m_grain.reset(new grain_info(*this, grain_path));
+    m_grain.reset(new grain_info(*this, grain_path, grain_voxel_cache, grain_voxel_threads));
     m_ecal.reset(new ecal_info(*this));
 
     auto subpath = m_root_path;
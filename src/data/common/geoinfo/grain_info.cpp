@@ -4,8 +4,19 @@
 
 #include <G4MultiUnion.hh>
 #include <G4SubtractionSolid.hh>
+#include <G4VSolid.hh>
 #include <G4VisExtent.hh>
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <thread>
+#include <vector>
+
 namespace sand {
 
   namespace {
@@ -64,12 +75,124 @@ namespace sand {
       return holes;
     }
 
+    constexpr std::uint64_t s_fnv_offset = 0xcbf29ce484222325ull;
+
+    std::uint64_t fnv1a(std::uint64_t hash, const char* data, std::size_t size) {
+      for (std::size_t i = 0; i != size; ++i) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 0x100000001b3ull;
+      }
+      return hash;
+    }
+
+    std::uint64_t hash_file(std::uint64_t hash, const std::filesystem::path& file) {
+      std::ifstream in(file, std::ios::binary);
+      if (!in) {
+        UFW_ERROR("Cannot read geometry file '{}'.", file.string());
+      }
+      char buffer[1 << 16];
+      while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0) {
+        hash = fnv1a(hash, buffer, in.gcount());
+      }
+      return hash;
+    }
+
+    /**
+     * FNV-1a of the files of the directory of a GDML file, recursively, in order of their relative paths, each preceded
+     * by that path. The parser reads the files included by the GDML file from there, so that any change to the
+     * geometry changes the hash. Voxel files are left out, in case the cache directory is in there too.
+     */
+    std::uint64_t hash_gdml_directory(const std::filesystem::path& gdml) {
+      auto dir = gdml.parent_path();
+      if (dir.empty()) {
+        dir = ".";
+      }
+      std::vector<std::filesystem::path> files;
+      for (const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
+        if (entry.is_regular_file() && entry.path().extension() != ".voxels" && entry.path().extension() != ".tmp") {
+          files.push_back(entry.path().lexically_relative(dir));
+        }
+      }
+      std::sort(files.begin(), files.end());
+      std::uint64_t hash = s_fnv_offset;
+      for (const auto& file : files) {
+        auto name = file.generic_string();
+        hash      = fnv1a(hash, name.c_str(), name.size() + 1);
+        hash      = hash_file(hash, dir / file);
+      }
+      return hash;
+    }
+
+    /// Header of a fiducial voxel file, followed by the voxels in voxel_array order
+    struct voxel_file_header {
+      char magic[8];
+      std::uint64_t key;
+      std::uint64_t size[3];
+    };
+
+    constexpr char s_voxel_magic[8] = {'S', 'A', 'N', 'D', 'V', 'O', 'X', '1'};
+
+    std::optional<grain::voxel_array<uint8_t>> read_voxels(const std::filesystem::path& file, std::uint64_t key,
+                                                           grain::size_3d count) {
+      std::ifstream in(file, std::ios::binary);
+      if (!in) {
+        return std::nullopt;
+      }
+      voxel_file_header header;
+      in.read(reinterpret_cast<char*>(&header), sizeof(header));
+      if (!in || std::memcmp(header.magic, s_voxel_magic, sizeof(s_voxel_magic)) != 0 || header.key != key
+          || header.size[0] != count.x() || header.size[1] != count.y() || header.size[2] != count.z()) {
+        UFW_WARN("Ignoring fiducial voxel file '{}', which does not match the geometry.", file.string());
+        return std::nullopt;
+      }
+      grain::voxel_array<uint8_t> voxels(count);
+      in.read(reinterpret_cast<char*>(voxels.data()), voxels.end() - voxels.begin());
+      if (!in) {
+        UFW_WARN("Ignoring truncated fiducial voxel file '{}'.", file.string());
+        return std::nullopt;
+      }
+      return voxels;
+    }
+
+    void write_voxels(const std::filesystem::path& file, std::uint64_t key, const grain::voxel_array<uint8_t>& voxels) {
+      voxel_file_header header;
+      std::memcpy(header.magic, s_voxel_magic, sizeof(s_voxel_magic));
+      header.key     = key;
+      header.size[0] = voxels.size().x();
+      header.size[1] = voxels.size().y();
+      header.size[2] = voxels.size().z();
+      // written aside and renamed, so that concurrent jobs never read a partial file
+      auto tmp = file;
+      tmp += fmt::format(".{}.tmp", ::getpid());
+      std::error_code ec;
+      std::filesystem::create_directories(file.parent_path(), ec);
+      {
+        std::ofstream out(tmp, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(voxels.data()), voxels.end() - voxels.begin());
+        if (!out) {
+          UFW_WARN("Cannot write fiducial voxel file '{}'.", tmp.string());
+          std::filesystem::remove(tmp, ec);
+          return;
+        }
+      }
+      std::filesystem::rename(tmp, file, ec);
+      if (ec) {
+        UFW_WARN("Cannot write fiducial voxel file '{}': {}.", file.string(), ec.message());
+        std::filesystem::remove(tmp, ec);
+      }
+    }
+
   } // namespace
 
   static constexpr char s_grain_path[] = "sand_inner_volume_PV_0/GRAIN_lv_PV_0/GRAIN_LAr_lv_PV_0";
 
-  geoinfo::grain_info::grain_info(const geoinfo& gi, const std::string& inner_geom)
-    : subdetector_info(gi, s_grain_path), m_fiducial_solid(nullptr) {
+  geoinfo::grain_info::grain_info(const geoinfo& gi, const std::string& inner_geom,
+                                  const std::filesystem::path& voxel_cache, std::size_t voxel_threads)
+    : subdetector_info(gi, s_grain_path),
+      m_fiducial_solid(nullptr),
+      m_voxel_cache(voxel_cache),
+      m_voxel_threads(std::max<std::size_t>(voxel_threads, 1)),
+      m_gdml_hash(0) {
     UFW_INFO("Reading grain geometry details from {}.", inner_geom);
     // Parsing of this geometry assumes the file is well formed and complete
     auto& gdml             = ufw::context::current()->instance<grain::geant_gdml_parser>(ufw::public_id(inner_geom));
@@ -95,6 +218,9 @@ namespace sand {
     if (!m_fiducial_solid) {
       UFW_ERROR("Geometry description does not contain a fiducial volume");
     }
+    if (!m_voxel_cache.empty()) {
+      m_gdml_hash = hash_gdml_directory(gdml.path());
+    }
     m_mask_cameras.reserve(lar_logical->GetNoDaughters());
     m_lens_cameras.reserve(lar_logical->GetNoDaughters());
     for (int i = 0; i != lar_logical->GetNoDaughters(); ++i) {
@@ -107,6 +233,7 @@ namespace sand {
         continue;
       }
     }
+    index_cameras();
   }
 
   geoinfo::grain_info::~grain_info() = default;
@@ -176,28 +303,37 @@ namespace sand {
     return path();
   }
 
-  const geoinfo::grain_info::camera& geoinfo::grain_info::at(channel_id::link_t id) const {
-    auto comp = [id](auto cam) { return cam.id == id; };
-    auto it   = std::find_if(m_lens_cameras.begin(), m_lens_cameras.end(), comp);
-    if (it != m_lens_cameras.end()) {
-      return *it;
+  void geoinfo::grain_info::index_cameras() {
+    m_camera_by_id.clear();
+    m_camera_by_name.clear();
+    auto add = [this](const camera& cam) {
+      if (cam.id >= m_camera_by_id.size()) {
+        m_camera_by_id.resize(cam.id + 1, nullptr);
+      }
+      if (!m_camera_by_id[cam.id]) {
+        m_camera_by_id[cam.id] = &cam;
+      }
+      m_camera_by_name.emplace(cam.name, &cam);
+    };
+    for (const auto& cam : m_lens_cameras) {
+      add(cam);
     }
-    auto it2 = std::find_if(m_mask_cameras.begin(), m_mask_cameras.end(), comp);
-    if (it2 != m_mask_cameras.end()) {
-      return *it2;
+    for (const auto& cam : m_mask_cameras) {
+      add(cam);
+    }
+  }
+
+  const geoinfo::grain_info::camera& geoinfo::grain_info::at(channel_id::link_t id) const {
+    if (id < m_camera_by_id.size() && m_camera_by_id[id]) {
+      return *m_camera_by_id[id];
     }
     UFW_ERROR("No camera of any type found with id = {}.", int(id));
   }
 
   const geoinfo::grain_info::camera& geoinfo::grain_info::at(const std::string& name) const {
-    auto comp = [name](auto cam) { return cam.name == name; };
-    auto it   = std::find_if(m_lens_cameras.begin(), m_lens_cameras.end(), comp);
-    if (it != m_lens_cameras.end()) {
-      return *it;
-    }
-    auto it2 = std::find_if(m_mask_cameras.begin(), m_mask_cameras.end(), comp);
-    if (it2 != m_mask_cameras.end()) {
-      return *it2;
+    auto it = m_camera_by_name.find(name);
+    if (it != m_camera_by_name.end()) {
+      return *it->second;
     }
     UFW_ERROR("No camera of any type found with name = '{}'.", name);
   }
@@ -207,29 +343,95 @@ namespace sand {
    * Voxels are arranged such that, if the number of voxels in one axis is odd, the middle is centered on zero;
    * if the number is even, the boundary is at zero.
    * This function treats each axis separately, voxels can be non-cubical.
+   * Grids are computed once per pitch, on the "grain_voxel_threads" threads of the geoinfo configuration, and kept;
+   * when a cache directory is configured they are also stored there and reused by later jobs, as long as the GDML files
+   * and the pitch are the same.
    */
   grain::voxel_array<uint8_t> geoinfo::grain_info::fiducial_voxels(dir_3d pitch) const {
     grain::size_3d count(std::ceil(2. * m_fiducial_aabb.x() / pitch.x()),
                          std::ceil(2. * m_fiducial_aabb.y() / pitch.y()),
                          std::ceil(2. * m_fiducial_aabb.z() / pitch.z()));
+    std::lock_guard lock(m_voxels_mutex);
+    auto cached = m_voxels.find({pitch.x(), pitch.y(), pitch.z()});
+    if (cached != m_voxels.end()) {
+      return cached->second.clone();
+    }
+
+    std::optional<grain::voxel_array<uint8_t>> mask;
+    std::filesystem::path file;
+    std::uint64_t key = 0;
+    if (!m_voxel_cache.empty()) {
+      key  = fiducial_key(pitch, count);
+      file = m_voxel_cache / fmt::format("fiducial_{:016x}.voxels", key);
+      mask = read_voxels(file, key, count);
+      if (mask) {
+        UFW_DEBUG("Read fiducial voxels from '{}'.", file.string());
+      }
+    }
+    if (!mask) {
+      mask = classify_fiducial(pitch, count);
+      if (!file.empty()) {
+        write_voxels(file, key, *mask);
+      }
+    }
+    cached = m_voxels.emplace(std::make_tuple(pitch.x(), pitch.y(), pitch.z()), std::move(*mask)).first;
+    return cached->second.clone();
+  }
+
+  grain::voxel_array<uint8_t> geoinfo::grain_info::classify_fiducial(dir_3d pitch, grain::size_3d count) const {
     grain::voxel_array<uint8_t> mask(count);
     dir_3d offset(count.x() / -2. * pitch.x(), count.y() / -2. * pitch.y(), count.z() / -2. * pitch.z());
     // super pedantic implementation, checks each vertex
-    mask.for_each([=](grain::index_3d idx, uint8_t& value) {
-      value = 0;
-      for (int corner = 0; corner != 8; ++corner) {
-        G4ThreeVector p(offset.x() + (idx.x() + (corner >> 2)) * pitch.x(),
-                        offset.y() + (idx.y() + (corner >> 1 & 1)) * pitch.y(),
-                        offset.z() + (idx.z() + (corner & 1)) * pitch.z());
-        if (m_fiducial_solid->Inside(p) != kOutside) {
-          value = 1;
-          break;
+    auto classify = [&](std::size_t x) {
+      for (std::size_t y = 0; y != count.y(); ++y) {
+        for (std::size_t z = 0; z != count.z(); ++z) {
+          grain::index_3d idx(x, y, z);
+          uint8_t value = 0;
+          for (int corner = 0; corner != 8; ++corner) {
+            G4ThreeVector p(offset.x() + (idx.x() + (corner >> 2)) * pitch.x(),
+                            offset.y() + (idx.y() + (corner >> 1 & 1)) * pitch.y(),
+                            offset.z() + (idx.z() + (corner & 1)) * pitch.z());
+            if (m_fiducial_solid->Inside(p) != kOutside) {
+              value = 1;
+              break;
+            }
+          }
+          mask.data()[mask.linear(idx)] = value;
         }
       }
-    });
+    };
+
+    // slabs of constant x are contiguous; solids are only read, as Geant4 itself does from its worker threads
+    std::size_t n_threads = std::max<std::size_t>(std::min<std::size_t>(m_voxel_threads, count.x()), 1);
+    UFW_DEBUG("Classifying {} x {} x {} fiducial voxels on {} threads.", count.x(), count.y(), count.z(), n_threads);
+    std::atomic<std::size_t> next_slab{0};
+    auto work = [&] {
+      for (std::size_t x = next_slab++; x < count.x(); x = next_slab++) {
+        classify(x);
+      }
+    };
+    std::vector<std::thread> threads;
+    for (std::size_t t = 1; t < n_threads; ++t) {
+      threads.emplace_back(work);
+    }
+    work();
+    for (auto& t : threads) {
+      t.join();
+    }
     return mask;
   }
 
+  /**
+   * Identifies a fiducial voxel grid: FNV-1a of the GDML directory the fiducial solid is read from, continued with the
+   * pitch and the grid size.
+   */
+  std::uint64_t geoinfo::grain_info::fiducial_key(dir_3d pitch, grain::size_3d count) const {
+    const double grid[]        = {pitch.x(), pitch.y(), pitch.z()};
+    const std::uint64_t size[] = {count.x(), count.y(), count.z()};
+    std::uint64_t hash         = fnv1a(m_gdml_hash, reinterpret_cast<const char*>(grid), sizeof(grid));
+    return fnv1a(hash, reinterpret_cast<const char*>(size), sizeof(size));
+  }
+
   /**
    * Returns voxel center position in the local reference frame given the 3D index.
    * Assuming that voxels are arranged such that, if the number of voxels in one axis is odd, the middle is centered on
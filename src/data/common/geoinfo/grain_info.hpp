@@ -1,6 +1,14 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
 
 #include <geoinfo/subdetector_info.hpp>
 
@@ -54,7 +62,12 @@ namespace sand {
     using size_3i = ROOT::Math::DisplacementVector3D<ROOT::Math::Cartesian3D<size_t>>;
 
    public:
-    grain_info(const geoinfo&, const std::string&);
+    grain_info(const geoinfo&, const std::string&, const std::filesystem::path& voxel_cache = {},
+               std::size_t voxel_threads = 1);
+
+    // the camera indices point into the camera vectors
+    grain_info(const grain_info&)             = delete;
+    grain_info& operator= (const grain_info&) = delete;
 
     virtual ~grain_info();
 
@@ -69,10 +82,10 @@ namespace sand {
     const camera& at(const std::string&) const;
 
     template <typename Camera>
-    std::enable_if_t<std::is_base_of_v<camera, Camera>, const Camera&> at(channel_id::link_t);
+    std::enable_if_t<std::is_base_of_v<camera, Camera>, const Camera&> at(channel_id::link_t) const;
 
     template <typename Camera>
-    std::enable_if_t<std::is_base_of_v<camera, Camera>, const Camera&> at(const std::string&);
+    std::enable_if_t<std::is_base_of_v<camera, Camera>, const Camera&> at(const std::string&) const;
 
     const std::vector<lens_camera>& lens_cameras() const { return m_lens_cameras; }
 
@@ -89,46 +102,61 @@ namespace sand {
    private:
     void add_camera_mask(G4VPhysicalVolume*, G4GDMLParser&);
     void add_camera_lens(G4VPhysicalVolume*, G4GDMLParser&);
+    void index_cameras();
+    grain::voxel_array<uint8_t> classify_fiducial(dir_3d pitch, grain::size_3d count) const;
+    std::uint64_t fiducial_key(dir_3d pitch, grain::size_3d count) const;
+
+    template <typename Camera>
+    const auto& cameras() const;
 
    private:
     std::vector<lens_camera> m_lens_cameras;
     std::vector<mask_camera> m_mask_cameras;
+    /// Cameras by id and by name, lens cameras first like the lookups always did
+    std::vector<const camera*> m_camera_by_id;
+    std::unordered_map<std::string, const camera*> m_camera_by_name;
     dir_3d m_fiducial_aabb;
     dir_3d m_LAr_aabb;
     G4VSolid* m_fiducial_solid;
+    /// Directory of the fiducial voxel files, disk caching is off when empty
+    std::filesystem::path m_voxel_cache;
+    /// Threads classifying the fiducial voxels
+    std::size_t m_voxel_threads;
+    /// FNV-1a of the GDML directory of the geometry, computed only when disk caching is on
+    std::uint64_t m_gdml_hash;
+    mutable std::mutex m_voxels_mutex;
+    mutable std::map<std::tuple<double, double, double>, grain::voxel_array<uint8_t>> m_voxels;
   };
 
   template <typename Camera>
-  std::enable_if_t<std::is_base_of_v<geoinfo::grain_info::camera, Camera>, const Camera&>
-  geoinfo::grain_info::at(channel_id::link_t id) {
-    auto comp = [id](auto cam) { return cam.id == id; };
+  const auto& geoinfo::grain_info::cameras() const {
     if constexpr (std::is_same_v<Camera, lens_camera>) {
-      auto it = std::find_if(m_lens_cameras.begin(), m_lens_cameras.end(), comp);
-      if (it != m_lens_cameras.end()) {
-        return *it;
-      }
+      return m_lens_cameras;
     } else {
-      auto it = std::find_if(m_mask_cameras.begin(), m_mask_cameras.end(), comp);
-      if (it != m_mask_cameras.end()) {
-        return *it;
-      }
+      return m_mask_cameras;
+    }
+  }
+
+  template <typename Camera>
+  std::enable_if_t<std::is_base_of_v<geoinfo::grain_info::camera, Camera>, const Camera&>
+  geoinfo::grain_info::at(channel_id::link_t id) const {
+    // ids are the positions in the vector of their type
+    const auto& cams = cameras<Camera>();
+    if (id < cams.size() && cams[id].id == id) {
+      return cams[id];
     }
     UFW_ERROR("No camera of the required type found with id = {}.", int(id));
   }
 
   template <typename Camera>
   std::enable_if_t<std::is_base_of_v<geoinfo::grain_info::camera, Camera>, const Camera&>
-  geoinfo::grain_info::at(const std::string& name) {
-    auto comp = [name](auto cam) { return cam.name == name; };
-    if constexpr (std::is_same_v<Camera, lens_camera>) {
-      auto it = std::find_if(m_lens_cameras.begin(), m_lens_cameras.end(), comp);
-      if (it != m_lens_cameras.end()) {
-        return *it;
-      }
-    } else {
-      auto it = std::find_if(m_mask_cameras.begin(), m_mask_cameras.end(), comp);
-      if (it != m_mask_cameras.end()) {
-        return *it;
+  geoinfo::grain_info::at(const std::string& name) const {
+    const auto& cams = cameras<Camera>();
+    auto it          = m_camera_by_name.find(name);
+    if (it != m_camera_by_name.end()) {
+      auto id = it->second->id;
+      if (id < cams.size() && &cams[id] == it->second) {
+        return cams[id];
       }
     }
     UFW_ERROR("No camera of the required type found with name = '{}'.", name);
@@ -1,6 +1,10 @@
 
 #include <hdf5.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
 namespace sand::hdf5 {
 
   namespace {
@@ -28,19 +32,113 @@ namespace sand::hdf5 {
       }
     }
 
+    // Target size of a chunk of a compressed dataset
+    constexpr size_t s_chunk_bytes = 1 << 20;
+
+    /**
+     * Chunks are made of whole trailing dimensions as long as they fit in s_chunk_bytes, so that rows are never
+     * split unless a single row is larger than that.
+     */
+    std::vector<hsize_t> chunk_dims(const std::vector<hsize_t>& dims, size_t type_size) {
+      std::vector<hsize_t> chunk(dims.size(), 1);
+      size_t bytes = type_size;
+      for (size_t i = dims.size(); i-- > 0;) {
+        if (bytes * dims[i] <= s_chunk_bytes) {
+          chunk[i] = dims[i];
+          bytes *= dims[i];
+        } else {
+          chunk[i] = std::max<hsize_t>(1, s_chunk_bytes / bytes);
+          break;
+        }
+      }
+      return chunk;
+    }
+
+    template <typename Location>
+    H5::DataSet create_dataset(Location& loc, const std::string& name, const H5::DataType& type,
+                               const std::vector<hsize_t>& dims, int compression) {
+      H5::DataSpace dataspace(dims.size(), dims.data());
+      H5::DSetCreatPropList plist;
+      const bool empty = std::find(dims.begin(), dims.end(), 0) != dims.end();
+      if (compression > 0 && !dims.empty() && !empty) {
+        auto chunk = chunk_dims(dims, type.getSize());
+        plist.setChunk(chunk.size(), chunk.data());
+        plist.setShuffle();
+        plist.setDeflate(compression);
+      }
+      return loc.createDataSet(name, type, dataspace, plist);
+    }
+
+    template <typename T>
+    void write_vector(H5::Group& group, const std::string& name, const std::vector<T>& v, const H5::PredType& type,
+                      int compression) {
+      H5::DataSet dataset = create_dataset(group, name, type, {v.size()}, compression);
+      if (!v.empty()) {
+        dataset.write(v.data(), type);
+      }
+    }
+
+    template <typename T>
+    std::vector<T> read_vector(const H5::Group& group, const std::string& name, const H5::PredType& type) {
+      H5::DataSet dataset = group.openDataSet(name);
+      std::vector<T> ret(dataset.getSpace().getSimpleExtentNpoints());
+      if (!ret.empty()) {
+        dataset.read(ret.data(), type);
+      }
+      return ret;
+    }
+
   } // namespace
 
   size_t ndarray::ndrange::flat_size() const {
-    return std::accumulate(begin(), end(), 1, [](auto lhs, auto rhs) { return lhs * rhs; });
+    return std::accumulate(begin(), end(), size_t{1}, [](auto lhs, auto rhs) { return lhs * rhs; });
+  }
+
+  ndarray::sparse_matrix ndarray::sparse_matrix::compress(const ndrange& shape, const float* dense, float threshold) {
+    sparse_matrix ret;
+    ret.shape = shape;
+    ret.shape.set_type(H5::PredType::NATIVE_FLOAT);
+    const size_t ncols = ret.columns();
+    const size_t nrows = ncols ? shape.flat_size() / ncols : 0;
+    ret.indptr.reserve(nrows + 1);
+    ret.indptr.push_back(0);
+    for (size_t r = 0; r != nrows; ++r) {
+      const float* row = dense + r * ncols;
+      for (size_t c = 0; c != ncols; ++c) {
+        if (std::abs(row[c]) > threshold) {
+          ret.indices.push_back(c);
+          ret.values.push_back(row[c]);
+        }
+      }
+      ret.indptr.push_back(ret.values.size());
+    }
+    return ret;
+  }
+
+  void ndarray::sparse_matrix::expand(float* dense) const {
+    const size_t ncols = columns();
+    std::fill_n(dense, shape.flat_size(), 0.f);
+    for (size_t r = 0; r != rows(); ++r) {
+      for (auto i = indptr[r]; i != indptr[r + 1]; ++i) {
+        dense[r * ncols + indices[i]] = values[i];
+      }
+    }
   }
 
   ndarray::ndarray(const ufw::config& cfg) try
-    : m_io_type(io_parse(cfg)), m_file(cfg.path_at("uri", m_io_type), acc_t(m_io_type)) {
-    // Only support top level datasets
+    : m_io_type(io_parse(cfg)),
+      m_file(cfg.path_at("uri", m_io_type), acc_t(m_io_type)),
+      m_compression(cfg.value("compression", 0)) {
+    if (m_compression < 0 || m_compression > 9) {
+      UFW_ERROR("Invalid compression level {}, values range from 0 (none) to 9", m_compression);
+    }
+    // Only support top level datasets, and sparse matrices as top level groups
     H5::Group group = m_file.openGroup("/");
     for (hsize_t i = 0; i < group.getNumObjs(); ++i) {
       if (group.getObjTypeByIdx(i) == H5G_DATASET) {
         m_datasets.push_back(group.getObjnameByIdx(i));
+      } else if (group.getObjTypeByIdx(i) == H5G_GROUP) {
+        m_sparse_matrices.push_back(group.getObjnameByIdx(i));
       }
     }
   } catch (H5::Exception& error) {
@@ -80,9 +178,40 @@ namespace sand::hdf5 {
   }
 
   void ndarray::write(const std::string& ds, const ndrange& nd, const void* ptr) {
-    H5::DataSpace dataspace(nd.size(), nd.data());
-    H5::DataSet dataset = m_file.createDataSet(ds, nd.type(), dataspace);
+    H5::DataSet dataset = create_dataset(m_file, ds, nd.type(), nd, m_compression);
     dataset.write(ptr, nd.type());
   }
 
+  ndarray::sparse_matrix ndarray::read_sparse(const std::string& name) try {
+    H5::Group group = m_file.openGroup(name);
+    sparse_matrix ret;
+    H5::Attribute shape = group.openAttribute("shape");
+    ret.shape.resize(shape.getSpace().getSimpleExtentNpoints());
+    shape.read(H5::PredType::NATIVE_HSIZE, ret.shape.data());
+    ret.shape.set_type(H5::PredType::NATIVE_FLOAT);
+    ret.indptr  = read_vector<std::uint64_t>(group, "indptr", H5::PredType::NATIVE_UINT64);
+    ret.indices = read_vector<std::uint32_t>(group, "indices", H5::PredType::NATIVE_UINT32);
+    ret.values  = read_vector<float>(group, "values", H5::PredType::NATIVE_FLOAT);
+    const size_t ncols = ret.columns();
+    if ((ncols ? ret.shape.flat_size() / ncols : 0) != ret.rows() || ret.indices.size() != ret.values.size()
+        || (!ret.indptr.empty() && ret.indptr.back() != ret.values.size())) {
+      UFW_ERROR("Sparse matrix '{}' is inconsistent with its shape.", name);
+    }
+    return ret;
+  } catch (H5::Exception& error) {
+    UFW_ERROR("HDF5 Error: {}", error.getDetailMsg());
+  }
+
+  void ndarray::write_sparse(const std::string& name, const sparse_matrix& matrix) try {
+    H5::Group group = m_file.createGroup(name);
+    hsize_t rank    = matrix.shape.size();
+    H5::Attribute shape = group.createAttribute("shape", H5::PredType::NATIVE_HSIZE, H5::DataSpace(1, &rank));
+    shape.write(H5::PredType::NATIVE_HSIZE, matrix.shape.data());
+    write_vector(group, "indptr", matrix.indptr, H5::PredType::NATIVE_UINT64, m_compression);
+    write_vector(group, "indices", matrix.indices, H5::PredType::NATIVE_UINT32, m_compression);
+    write_vector(group, "values", matrix.values, H5::PredType::NATIVE_FLOAT, m_compression);
+  } catch (H5::Exception& error) {
+    UFW_ERROR("HDF5 Error: {}", error.getDetailMsg());
+  }
+
 } // namespace sand::hdf5
@@ -8,6 +8,10 @@
 #include <H5DataType.h>
 #include <H5PredType.h>
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
 namespace sand::hdf5 {
 
   class ndarray : public ufw::data::base<ufw::data::complex_tag, ufw::data::instanced_tag, ufw::data::global_tag> {
@@ -24,7 +28,38 @@ namespace sand::hdf5 {
       H5::DataType m_type;
     };
 
+    /**
+     * A float array stored in compressed sparse row form. The last dimension of @p shape are the columns, the others
+     * are flattened into rows in C order. Row r holds the columns indices[indptr[r]] to indices[indptr[r + 1] - 1],
+     * sorted, with the corresponding values.
+     */
+    struct sparse_matrix {
+      ndrange shape;
+      std::vector<std::uint64_t> indptr;
+      std::vector<std::uint32_t> indices;
+      std::vector<float> values;
+
+      /**
+       * Builds the sparse form of a dense array, dropping all the elements whose absolute value is not above
+       * @p threshold.
+       */
+      static sparse_matrix compress(const ndrange& shape, const float* dense, float threshold = 0.f);
+
+      /**
+       * Writes the dense array into the user provided pointer, which must hold shape.flat_size() floats.
+       */
+      void expand(float* dense) const;
+
+      size_t rows() const { return indptr.empty() ? 0 : indptr.size() - 1; }
+
+      size_t columns() const { return shape.empty() ? 0 : shape.back(); }
+    };
+
    public:
+    /**
+     * If the "compression" option (default 0) is a deflate level between 1 and 9, datasets are written chunked and
+     * compressed. Reading is not affected.
+     */
     ndarray(const ufw::config&);
 
     virtual ~ndarray() = default;
@@ -41,6 +76,11 @@ namespace sand::hdf5 {
      */
     const std::vector<std::string>& datasets() const { return m_datasets; }
 
+    /**
+     * List all the sparse matrices in this file.
+     */
+    const std::vector<std::string>& sparse_matrices() const { return m_sparse_matrices; }
+
     /**
      * Provides metadata on the given dataset.
      */
@@ -57,6 +97,16 @@ namespace sand::hdf5 {
      */
     void write(const std::string&, const ndrange&, const void*);
 
+    /**
+     * Reads a sparse matrix written by write_sparse().
+     */
+    sparse_matrix read_sparse(const std::string&);
+    /**
+     * Writes a sparse matrix as a group holding the "indptr", "indices" and "values" datasets, with the dense shape
+     * as the "shape" attribute of the group.
+     */
+    void write_sparse(const std::string&, const sparse_matrix&);
+
     /**
      * Reads the entire dataset into the user provided object.
      * The object must provide sufficient space, either by pointing to adequate memory,
@@ -88,7 +138,9 @@ namespace sand::hdf5 {
    private:
     ufw::config::io m_io_type;
     H5::H5File m_file;
+    int m_compression;
     std::vector<std::string> m_datasets;
+    std::vector<std::string> m_sparse_matrices;
   };
 
 } // namespace sand::hdf5
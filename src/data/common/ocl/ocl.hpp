@@ -4,6 +4,8 @@
 #include <ufw/config.hpp>
 #include <ufw/data.hpp>
 
+#include <utility>
+
 #define CL_HPP_ENABLE_EXCEPTIONS
 #define CL_HPP_TARGET_OPENCL_VERSION 220
 #include <CL/cl2.hpp>
@@ -92,7 +94,9 @@ namespace sand::cl {
       autounmapping_ptr(cl::Buffer& buf, cl::CommandQueue& q) : r_buf(buf), r_q(q), map_ptr(nullptr) {}
       autounmapping_ptr(const autounmapping_ptr&)             = delete;
       autounmapping_ptr& operator= (const autounmapping_ptr&) = delete;
-      autounmapping_ptr(autounmapping_ptr&&)                  = default;
+      autounmapping_ptr(autounmapping_ptr&& other)
+        : r_buf(other.r_buf), r_q(other.r_q), map_evt(std::move(other.map_evt)),
+          map_ptr(std::exchange(other.map_ptr, nullptr)) {}
       ~autounmapping_ptr() {
         if (map_ptr)
           unmap();
@@ -125,6 +129,8 @@ namespace sand::cl {
     };
 
    public:
+    using mapped_ptr = autounmapping_ptr;
+
     buffer()  = default;
     ~buffer() = default;
 
@@ -2,10 +2,14 @@
 #include <ufw/config.hpp>
 
 #include <TGeoManager.h>
+#include <TGeoNode.h>
+#include <TGeoVolume.h>
+
+#include <string_view>
 
 namespace sand {
 
-  root_tgeomanager::root_tgeomanager(const ufw::config& cfg) {
+  root_tgeomanager::root_tgeomanager(const ufw::config& cfg) : m_shared(std::make_unique<shared_state>()) {
     if (gGeoManager) {
       UFW_FATAL("Does not support multiple geomanagers. Existing instance at {}.", fmt::ptr(gGeoManager));
     }
@@ -28,7 +32,75 @@ namespace sand {
 
   std::unique_ptr<root_tgeomanager::tgeonav, root_tgeomanager::geonav_deleter> root_tgeomanager::navigator() {
     auto nav = static_cast<tgeonav*>(m_geomanager->GetCurrentNavigator());
+    if (nav == nullptr && m_geomanager->IsMultiThread()) {
+      std::lock_guard<std::mutex> lock(m_shared->mutex);
+      nav = static_cast<tgeonav*>(m_geomanager->AddNavigator());
+      m_shared->navigator_threads.insert(std::this_thread::get_id());
+    }
     return std::unique_ptr<root_tgeomanager::tgeonav, root_tgeomanager::geonav_deleter>(nav, this);
   }
 
+  /**
+   * Does nothing if the calling thread was not given a navigator by navigator(), so the navigator of the thread which
+   * loaded the geometry is never deleted. Once the last of these navigators is gone, the map of ROOT thread ids is
+   * cleared, so that the ids given to later threads start from 0 again instead of growing past the maximum number of
+   * threads.
+   */
+  void root_tgeomanager::release_navigator() {
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    if (m_shared->navigator_threads.erase(std::this_thread::get_id()) == 0) {
+      return;
+    }
+    m_geomanager->RemoveNavigator(m_geomanager->GetCurrentNavigator());
+    if (m_shared->navigator_threads.empty()) {
+      m_geomanager->ClearThreadsMap();
+    }
+  }
+
+  void root_tgeomanager::set_max_threads(std::size_t n) {
+    if (n > 1 && static_cast<std::size_t>(TGeoManager::GetMaxThreads()) < n) {
+      UFW_DEBUG("Enabling navigation of the geometry from {} threads.", n);
+      m_geomanager->SetMaxThreads(n);
+    }
+  }
+
+  /**
+   * Matches the names of all the nodes of the geometry, which are the top node and the daughters of every volume.
+   */
+  root_tgeomanager::node_name_masks::node_name_masks(TGeoManager* geomanager, const name_sets& sets) {
+    auto add = [&](const TGeoNode* node) {
+      std::string_view name = node->GetName();
+      std::uint32_t mask    = 0;
+      for (std::size_t i = 0; i != sets.size(); ++i) {
+        for (const auto& n : sets[i]) {
+          if (name.find(n) != std::string_view::npos) {
+            mask |= std::uint32_t{1} << i;
+            break;
+          }
+        }
+      }
+      m_masks.emplace(node, mask);
+    };
+    add(geomanager->GetTopNode());
+    for (auto obj : *geomanager->GetListOfVolumes()) {
+      auto volume = static_cast<const TGeoVolume*>(obj);
+      for (int i = 0; i != volume->GetNdaughters(); ++i) {
+        add(volume->GetNode(i));
+      }
+    }
+  }
+
+  const root_tgeomanager::node_name_masks& root_tgeomanager::name_masks(const node_name_masks::name_sets& sets) {
+    if (sets.size() > 32) {
+      UFW_ERROR("At most 32 name sets can be matched against the node names, {} given.", sets.size());
+    }
+    std::lock_guard<std::mutex> lock(m_shared->mutex);
+    auto& masks = m_shared->name_masks[sets];
+    if (!masks) {
+      masks = std::make_unique<const node_name_masks>(m_geomanager, sets);
+      UFW_DEBUG("Matched the names of the geometry nodes against {} name sets.", sets.size());
+    }
+    return *masks;
+  }
+
 } // namespace sand
@@ -7,6 +7,16 @@
 #include <TGeoManager.h>
 #include <TGeoNavigator.h>
 
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 namespace sand {
 
   /**
@@ -41,7 +51,25 @@ namespace sand {
       void for_each_node(Func&& f) const;
     };
 
+    /**
+     * Bit mask of every node of the geometry, where bit i is set if the node name contains any of the names of set i.
+     * It is computed once for all the nodes, lookups do not look at the names anymore.
+     */
+    class node_name_masks {
+     public:
+      using name_sets = std::vector<std::vector<std::string>>;
+
+      node_name_masks(TGeoManager*, const name_sets&);
+      /// Mask of a node, 0 for nullptr or a node which is not in the geometry.
+      inline std::uint32_t operator() (const TGeoNode*) const;
+
+     private:
+      std::unordered_map<const TGeoNode*, std::uint32_t> m_masks;
+    };
+
    private:
+    /// Navigators belong to their thread and keep their state between calls to navigator(), so the pointers it returns
+    /// do not own them. Threads other than the one which loaded the geometry give theirs back with release_navigator().
     struct geonav_deleter {
       geonav_deleter(root_tgeomanager*);
       void operator() (tgeonav*);
@@ -70,12 +98,34 @@ namespace sand {
 
     using navigator_ptr = std::unique_ptr<tgeonav, geonav_deleter>;
 
+    /// Navigator of the calling thread, created on first use when the geometry is navigated from several threads.
     navigator_ptr navigator();
 
+    /// Deletes the navigator created by navigator() for the calling thread, to be called before the thread ends.
+    void release_navigator();
+
+    /// Allows the geometry to be navigated concurrently from up to n threads.
+    void set_max_threads(std::size_t n);
+
+    /// Masks of the nodes for the given name sets, built on the first call and kept as long as the geometry.
+    const node_name_masks& name_masks(const node_name_masks::name_sets&);
+
    private:
     TGeoManager* m_geomanager;
+
+    struct shared_state {
+      std::mutex mutex;
+      std::map<node_name_masks::name_sets, std::unique_ptr<const node_name_masks>> name_masks;
+      std::set<std::thread::id> navigator_threads; ///< Threads given a navigator by navigator(), not released yet.
+    };
+    std::unique_ptr<shared_state> m_shared;
   };
 
+  inline std::uint32_t root_tgeomanager::node_name_masks::operator() (const TGeoNode* node) const {
+    auto mask = m_masks.find(node);
+    return mask == m_masks.end() ? 0 : mask->second;
+  }
+
   inline void root_tgeomanager::tgeonav::cd(const geo_path& p) {
     if (!TGeoNavigator::cd(p.c_str())) {
       UFW_EXCEPT(path_not_found, p);
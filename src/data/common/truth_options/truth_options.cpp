@@ -0,0 +1,18 @@
+#include <truth_options.hpp>
+#include <ufw/config.hpp>
+#include <ufw/utils.hpp>
+
+#include <common/truth.h>
+
+namespace sand {
+
+  truth_options::truth_options(const ufw::config& cfg) : m_enabled{cfg.value("enabled", true)} {
+    if (m_enabled && !truth::enabled()) {
+      UFW_WARN("MC truth requested, but this build has no truth bookkeeping (SANDRECO_NO_TRUTH).");
+    }
+    truth::set_enabled(m_enabled);
+    m_enabled = truth::enabled();
+    UFW_INFO("MC truth bookkeeping is {}.", m_enabled ? "on" : "off");
+  }
+
+} // namespace sand
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <ufw/data.hpp>
+
+namespace sand {
+
+  /**
+   * MC truth settings of the whole job, read once from its globals:
+   *
+   *     "sand::truth_options" : { "enabled" : false }
+   *
+   * With truth off, sand::truth objects stay empty and the processes producing them skip their truth bookkeeping. All
+   * processes of a job see the same setting, whatever order they are configured in. Builds with SANDRECO_NO_TRUTH
+   * always have truth off.
+   */
+  class truth_options : ufw::data::base<ufw::data::complex_tag, ufw::data::unique_tag, ufw::data::global_tag> {
+   public:
+    explicit truth_options(const ufw::config&);
+    bool enabled() const { return m_enabled; }
+
+   private:
+    bool m_enabled;
+  };
+
+} // namespace sand
+
+UFW_DECLARE_COMPLEX_DATA(sand::truth_options);
@@ -5,9 +5,9 @@
 
 namespace sand::grain {
 
-  geant_gdml_parser::geant_gdml_parser(const ufw::config& cfg) {
+  geant_gdml_parser::geant_gdml_parser(const ufw::config& cfg) : m_path(cfg.path_at("path")) {
     // this little manouver is needed because of improper handling of relative paths elsewhere...
-    auto path          = cfg.path_at("path");
+    const auto& path   = m_path;
     auto starting_path = std::filesystem::current_path();
     UFW_DEBUG("Starting path {}", std::filesystem::current_path().string());
     UFW_DEBUG("Setting path {}", path.parent_path().string());
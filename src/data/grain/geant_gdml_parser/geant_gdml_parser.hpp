@@ -2,6 +2,8 @@
 
 #include <G4GDMLParser.hh>
 
+#include <filesystem>
+
 namespace sand::grain {
 
   struct geant_gdml_parser
@@ -9,6 +11,12 @@ namespace sand::grain {
     , public ufw::data::base<ufw::data::complex_tag, ufw::data::instanced_tag, ufw::data::global_tag> {
    public:
     explicit geant_gdml_parser(const ufw::config&);
+
+    /// Path of the GDML file the geometry was read from.
+    const std::filesystem::path& path() const { return m_path; }
+
+   private:
+    std::filesystem::path m_path;
   };
 
 } // namespace sand::grain
@@ -1,9 +1,31 @@
+#include <ufw/config.hpp>
 #include <ufw/factory.hpp>
 
 #include <geant_run_manager.hpp>
 
+#ifdef G4MULTITHREADED
+#  include <G4MTRunManager.hh>
+#endif
+
 namespace sand::grain {
 
-  geant_run_manager::geant_run_manager(const ufw::config&) {}
+  geant_run_manager::geant_run_manager(const ufw::config& cfg) {
+    m_threads = cfg.value("threads", m_threads);
+#ifdef G4MULTITHREADED
+    if (m_threads > 0) {
+      UFW_INFO("Creating a multi-threaded Geant4 run manager with {} threads.", m_threads);
+      auto run_manager = std::make_unique<G4MTRunManager>();
+      run_manager->SetNumberOfThreads(m_threads);
+      m_run_manager = std::move(run_manager);
+      return;
+    }
+#else
+    if (m_threads > 0) {
+      UFW_WARN("Geant4 was built without multi-threading support, ignoring 'threads' = {}.", m_threads);
+      m_threads = 0;
+    }
+#endif
+    m_run_manager = std::make_unique<G4RunManager>();
+  }
 
 } // namespace sand::grain
@@ -2,13 +2,30 @@
 
 #include <G4RunManager.hh>
 
+#include <memory>
+
 namespace sand::grain {
 
-  struct geant_run_manager
-    : public G4RunManager
-    , public ufw::data::base<ufw::data::complex_tag, ufw::data::unique_tag, ufw::data::global_tag> {
+  /**
+   * Owner of the Geant4 run manager of the job. With a positive "threads" option the events of each run are processed
+   * by that many worker threads, otherwise the sequential G4RunManager is used. User initializations must then follow
+   * the Geant4 multi-threading rules: sensitive detectors are created in ConstructSDandField and user actions in
+   * G4VUserActionInitialization::Build, once per worker.
+   */
+  class geant_run_manager
+    : public ufw::data::base<ufw::data::complex_tag, ufw::data::unique_tag, ufw::data::global_tag> {
    public:
     explicit geant_run_manager(const ufw::config&);
+
+    G4RunManager& operator* () const { return *m_run_manager; }
+
+    G4RunManager* operator->() const { return m_run_manager.get(); }
+
+    std::size_t threads() const { return m_threads; }
+
+   private:
+    std::size_t m_threads{0};
+    std::unique_ptr<G4RunManager> m_run_manager;
   };
 
 } // namespace sand::grain
@@ -0,0 +1,135 @@
+#include <ufw/config.hpp>
+#include <ufw/context.hpp>
+#include <ufw/data.hpp>
+#include <ufw/factory.hpp>
+#include <ufw/process.hpp>
+
+#include <common/utils/compare.h>
+#include <edep_reader/edep_cache.hpp>
+#include <edep_reader/edep_reader.hpp>
+
+namespace sand::common {
+
+  /**
+   * Checks an edep cache file against the spills decoded directly from the EDepSim file by the edep_reader. Every
+   * trajectory, hit, trajectory point, first and last point in a component, entering and exiting flag and hit segment
+   * of the cached record must be equal to the decoded one.
+   */
+  class edep_cache_test : public ufw::process {
+   public:
+    edep_cache_test();
+    void configure(const ufw::config& cfg) override;
+    void run() override;
+
+   private:
+    std::unique_ptr<edep_cache::reader> m_cache;
+  };
+
+  namespace {
+
+    void check(bool condition, const EDEPTrajectory& trj, const char* what) {
+      if (!condition) {
+        UFW_ERROR("Cached trajectory {} differs from the decoded one: {}.", trj.GetId(), what);
+      }
+    }
+
+    void compare(const EDEPTrajectory& trj, const EDEPTrajectoryPoints& decoded, const EDEPTrajectoryPoints& cached,
+                 const char* what) {
+      check(decoded.size() == cached.size(), trj, what);
+      for (const auto& [comp, points] : decoded) {
+        auto other = cached.find(comp);
+        check(other != cached.end() && other->second.size() == points.size(), trj, what);
+        for (std::size_t i = 0; i != points.size(); ++i) {
+          const auto& a = points[i];
+          const auto& b = other->second[i];
+          check(a.GetPosition() == b.GetPosition() && a.GetMomentum() == b.GetMomentum()
+                    && a.GetProcess() == b.GetProcess() && a.GetSubprocess() == b.GetSubprocess(),
+                trj, what);
+        }
+      }
+    }
+
+    void compare(const EDEPTrajectory& decoded, const EDEPTrajectory& cached) {
+      check(decoded.GetId() == cached.GetId(), decoded, "ID");
+      check(decoded.GetParentId() == cached.GetParentId(), decoded, "parent ID");
+      check(decoded.GetDepth() == cached.GetDepth(), decoded, "depth");
+      check(decoded.GetPDGCode() == cached.GetPDGCode(), decoded, "PDG code");
+      check(decoded.GetInteractionNumber() == cached.GetInteractionNumber(), decoded, "interaction number");
+      check(decoded.GetReaction() == cached.GetReaction(), decoded, "reaction");
+      check(decoded.GetInitialMomentum() == cached.GetInitialMomentum(), decoded, "initial momentum");
+
+      const auto& decoded_hits = decoded.GetHitMap();
+      const auto& cached_hits  = cached.GetHitMap();
+      check(decoded_hits.size() == cached_hits.size(), decoded, "hit components");
+      for (const auto& [comp, hits] : decoded_hits) {
+        auto other = cached_hits.find(comp);
+        check(other != cached_hits.end() && other->second.size() == hits.size(), decoded, "number of hits");
+        for (std::size_t i = 0; i != hits.size(); ++i) {
+          const auto& a = hits[i];
+          const auto& b = other->second[i];
+          check(a.GetId() == b.GetId() && a.GetStart() == b.GetStart() && a.GetStop() == b.GetStop()
+                    && a.GetEnergyDeposit() == b.GetEnergyDeposit()
+                    && a.GetSecondaryDeposit() == b.GetSecondaryDeposit()
+                    && a.GetTrackLength() == b.GetTrackLength() && a.GetContrib() == b.GetContrib()
+                    && a.GetPrimaryId() == b.GetPrimaryId(),
+                decoded, "hit");
+        }
+      }
+
+      compare(decoded, decoded.GetTrajectoryPoints(), cached.GetTrajectoryPoints(), "trajectory points");
+      compare(decoded, decoded.GetFirstPoints(), cached.GetFirstPoints(), "first points in a component");
+      compare(decoded, decoded.GetLastPoints(), cached.GetLastPoints(), "last points in a component");
+
+      // the flags are kept for every named component, OTHER excluded
+      for (const auto& [comp, name] : component_to_string) {
+        check(decoded.IsEntering(comp) == cached.IsEntering(comp), decoded, "entering flag");
+        check(decoded.IsExiting(comp) == cached.IsExiting(comp), decoded, "exiting flag");
+      }
+    }
+
+    bool same_segment(const TG4HitSegment& a, const TG4HitSegment& b) {
+      return a.GetPrimaryId() == b.GetPrimaryId() && a.GetEnergyDeposit() == b.GetEnergyDeposit()
+          && a.GetSecondaryDeposit() == b.GetSecondaryDeposit() && a.GetTrackLength() == b.GetTrackLength()
+          && a.GetStart() == b.GetStart() && a.GetStop() == b.GetStop() && a.Contrib == b.Contrib;
+    }
+
+  } // namespace
+
+  void edep_cache_test::configure(const ufw::config& cfg) {
+    process::configure(cfg);
+    m_cache = std::make_unique<edep_cache::reader>(cfg.path_at("uri").string());
+    UFW_INFO("Configuring edep_cache_test at {}.", fmt::ptr(this));
+  }
+
+  edep_cache_test::edep_cache_test() : process({}, {}) {
+    UFW_INFO("Creating an edep_cache_test process at {}.", fmt::ptr(this));
+  }
+
+  void edep_cache_test::run() {
+    const auto& decoded = get<sand::edep_reader>();
+    if (decoded.from_cache()) {
+      UFW_ERROR("edep_cache_test needs the edep_reader to decode the EDepSim file, not to read a cache.");
+    }
+    EDEPTree cached;
+    std::vector<TG4HitSegment> segments;
+    m_cache->read(ufw::context::current()->id(), cached, segments);
+
+    // compare() raises the error itself, naming the field which differs
+    utils::check_same(
+        cached, decoded,
+        [](const EDEPTrajectory& a, const EDEPTrajectory& b) {
+          compare(b, a);
+          return true;
+        },
+        "cached trajectories");
+    utils::check_same(
+        segments, decoded.segments(),
+        [](const TG4HitSegment& a, const TG4HitSegment* b) { return same_segment(*b, a); }, "cached hit segments");
+    UFW_INFO("Cached spill matches the decoded one: {} trajectories, {} hit segments.", cached.size(),
+             segments.size());
+  }
+
+} // namespace sand::common
+
+UFW_REGISTER_PROCESS(sand::common::edep_cache_test)
+UFW_REGISTER_DYNAMIC_PROCESS_FACTORY(sand::common::edep_cache_test)
@@ -0,0 +1,43 @@
+#include <ufw/config.hpp>
+#include <ufw/context.hpp>
+#include <ufw/data.hpp>
+#include <ufw/factory.hpp>
+#include <ufw/process.hpp>
+
+#include <edep_reader/edep_cache.hpp>
+#include <edep_reader/edep_reader.hpp>
+
+namespace sand::common {
+
+  /**
+   * Dumps the decoded spills of the edep_reader into an edep cache file, which can be read back by setting "cache" in
+   * the edep_reader configuration.
+   */
+  class edep_cache_writer : public ufw::process {
+   public:
+    edep_cache_writer();
+    void configure(const ufw::config& cfg) override;
+    void run() override;
+
+   private:
+    std::unique_ptr<edep_cache::writer> m_writer;
+  };
+
+  void edep_cache_writer::configure(const ufw::config& cfg) {
+    process::configure(cfg);
+    m_writer = std::make_unique<edep_cache::writer>(cfg.path_at("uri").string());
+  }
+
+  edep_cache_writer::edep_cache_writer() : process({}, {}) {
+    UFW_DEBUG("Creating an edep_cache_writer process at {}", fmt::ptr(this));
+  }
+
+  void edep_cache_writer::run() {
+    const auto& tree = get<sand::edep_reader>();
+    m_writer->write(ufw::context::current()->id(), tree, tree.segments());
+  }
+
+} // namespace sand::common
+
+UFW_REGISTER_PROCESS(sand::common::edep_cache_writer)
+UFW_REGISTER_DYNAMIC_PROCESS_FACTORY(sand::common::edep_cache_writer)
@@ -0,0 +1,103 @@
+#include <ufw/config.hpp>
+#include <ufw/context.hpp>
+#include <ufw/data.hpp>
+#include <ufw/factory.hpp>
+#include <ufw/process.hpp>
+
+#include <geoinfo/geoinfo.hpp>
+#include <geoinfo/grain_info.hpp>
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+
+namespace sand::common {
+
+  /**
+   * Checks the fiducial voxel cache of grain_info. The grid of the configured pitch is classified on one thread without
+   * any cache, then by a grain_info caching it in an emptied directory with the configured number of threads, and
+   * finally read back from that directory by another grain_info. The three grids must be identical, and the last one
+   * must come from the file written by the second, which must be left untouched.
+   */
+  class voxel_cache_test : public ufw::process {
+   public:
+    voxel_cache_test();
+    void configure(const ufw::config& cfg) override;
+    void run() override;
+
+   private:
+    std::string m_geometry;
+    std::filesystem::path m_cache;
+    std::size_t m_threads;
+    dir_3d m_pitch;
+  };
+
+  namespace {
+
+    void check_same(const grain::voxel_array<uint8_t>& voxels, const grain::voxel_array<uint8_t>& reference,
+                    const char* what) {
+      if (voxels.size() != reference.size()) {
+        UFW_ERROR("The {} fiducial voxels have size {}, the reference ones {}.", what, voxels.size(), reference.size());
+      }
+      auto diff = std::mismatch(voxels.begin(), voxels.end(), reference.begin());
+      if (diff.first != voxels.end()) {
+        UFW_ERROR("The {} fiducial voxels differ from the reference ones at voxel {}.", what,
+                  diff.first - voxels.begin());
+      }
+    }
+
+    std::filesystem::path only_voxel_file(const std::filesystem::path& dir) {
+      std::filesystem::path found;
+      for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        if (entry.path().extension() == ".voxels") {
+          if (!found.empty()) {
+            UFW_ERROR("More than one fiducial voxel file in '{}'.", dir.string());
+          }
+          found = entry.path();
+        }
+      }
+      if (found.empty()) {
+        UFW_ERROR("No fiducial voxel file was written in '{}'.", dir.string());
+      }
+      return found;
+    }
+
+  } // namespace
+
+  void voxel_cache_test::configure(const ufw::config& cfg) {
+    process::configure(cfg);
+    m_geometry = std::string(cfg.at("geometry"));
+    m_cache    = cfg.path_at("cache");
+    m_threads  = cfg.value("threads", std::size_t{4});
+    auto pitch = cfg.value("pitch", std::array<double, 3>{15., 15., 500.});
+    m_pitch    = dir_3d(pitch[0], pitch[1], pitch[2]);
+    UFW_INFO("Configuring voxel_cache_test at {}.", fmt::ptr(this));
+  }
+
+  voxel_cache_test::voxel_cache_test() : process({}, {}) {
+    UFW_INFO("Creating a voxel_cache_test process at {}.", fmt::ptr(this));
+  }
+
+  void voxel_cache_test::run() {
+    const auto& gi = instance<geoinfo>();
+    std::filesystem::remove_all(m_cache);
+
+    auto fresh = geoinfo::grain_info(gi, m_geometry).fiducial_voxels(m_pitch);
+
+    auto written = geoinfo::grain_info(gi, m_geometry, m_cache, m_threads).fiducial_voxels(m_pitch);
+    check_same(written, fresh, "multi-threaded");
+    auto file  = only_voxel_file(m_cache);
+    auto mtime = std::filesystem::last_write_time(file);
+
+    auto read = geoinfo::grain_info(gi, m_geometry, m_cache, m_threads).fiducial_voxels(m_pitch);
+    check_same(read, fresh, "cached");
+    if (only_voxel_file(m_cache) != file || std::filesystem::last_write_time(file) != mtime) {
+      UFW_ERROR("The fiducial voxel file '{}' was written again instead of being read.", file.string());
+    }
+    UFW_INFO("Fiducial voxels read from '{}' match the computed ones: {} voxels.", file.string(), fresh.size());
+  }
+
+} // namespace sand::common
+
+UFW_REGISTER_PROCESS(sand::common::voxel_cache_test)
+UFW_REGISTER_DYNAMIC_PROCESS_FACTORY(sand::common::voxel_cache_test)
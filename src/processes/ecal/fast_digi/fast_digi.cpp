@@ -2,6 +2,7 @@
 #include <geoinfo/ecal_info.hpp>
 #include <ecal/digit.h>
 #include <ecal/photo_electron.h>
+#include <truth_options/truth_options.hpp>
 
 namespace sand::ecal {
 
@@ -16,10 +17,14 @@ namespace sand::ecal {
     m_pe_threshold = cfg.at("pe_threshold");
     // Constant fraction for timing discrimination (constant fraction discriminator)
     m_costant_fraction = cfg.at("costant_fraction");
+    // MC truth bookkeeping, set for the whole job in the globals
+    m_truth = instance<truth_options>().enabled();
   }
 
   /// Constructor: Initialize digitization process with PES input and DIGI output
-  fast_digi::fast_digi() : process({{"pes", "sand::ecal::pes_container"}}, {{"digi", "sand::ecal::digits_container"}}) {
+  fast_digi::fast_digi()
+      : process({{"pes", "sand::ecal::pes_container"}},
+                {{"digi", "sand::ecal::digits_container"}, {"truth", "sand::truth_pool"}}) {
     UFW_DEBUG("Creating a ecal fast digitization process at {}", fmt::ptr(this));
   }
 
@@ -33,6 +38,8 @@ namespace sand::ecal {
     auto& pes = get<sand::ecal::pes_container>("pes");
     // Get output digitized signal collection
     auto& digi = set<sand::ecal::digits_container>("digi");
+    // Truth sets of the digitized signals, merged as cached unions
+    auto& truths = set<truth_pool>("truth");
 
     // Process photo-electrons for each PMT channel
     for (auto [pmt, pe_collection] : pes.collection) {
@@ -69,17 +76,19 @@ namespace sand::ecal {
           // account a maximal path length for scintillation photons of 5 m, a velocity of
           // 5.85 ns/m and a scintillation time of 3.08 ns, which gives a total of about 35 ns.
           digits_container::digit signal{reco::digi{pmt, reco::digi::time{tdc - 35., tdc, tdc + 5.}}, adc, tdc, tot};
-          // Collect all truth hits from photo-electrons in this pulse
-          std::vector<pes_container::photo_electron>::iterator it = start_pe;
+          if (m_truth) {
+            // Collect all truth hits from photo-electrons in this pulse
+            std::vector<pes_container::photo_electron>::iterator it = start_pe;
 
-          // Add truth hit information from all contributing photo-electrons
-          while (it != this_pe) {
-            signal.insert(it->true_hits());
-            it++;
+            // Add truth hit information from all contributing photo-electrons
+            while (it != this_pe) {
+              truths.insert(signal, *it);
+              it++;
+            }
+            // Include the boundary photo-electron if it exists
+            if (this_pe != pe_collection.end())
+              truths.insert(signal, *this_pe);
           }
-          // Include the boundary photo-electron if it exists
-          if (this_pe != pe_collection.end())
-            signal.insert(this_pe->true_hits());
 
           // Store the digitized signal in output collection
           digi.digits.push_back(signal);
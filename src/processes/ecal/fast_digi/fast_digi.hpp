@@ -21,6 +21,9 @@ namespace sand::ecal {
 
     /// @brief Constant fraction for timing discrimination
     double m_costant_fraction;
+
+    /// @brief Whether the digits carry the truth of their photo-electrons
+    bool m_truth;
   };
 } // namespace sand::ecal
 
@@ -2,6 +2,7 @@
 #include <edep_reader/edep_reader.hpp>
 #include <geoinfo/ecal_info.hpp>
 #include <ecal/photo_electron.h>
+#include <truth_options/truth_options.hpp>
 
 namespace sand::ecal {
 
@@ -10,6 +11,8 @@ namespace sand::ecal {
     process::configure(cfg);
     // Load the light yield (photons per MeV) from configuration
     m_light_yield = cfg.at("light_yield");
+    // MC truth bookkeeping, set for the whole job in the globals
+    m_truth = instance<truth_options>().enabled();
   }
 
   /// Constructor: Initialize the optical simulation process with output PES data
@@ -73,8 +76,9 @@ namespace sand::ecal {
             // Calculate total arrival time: initial time + scintillation + propagation
             auto arrival_time = h_t + scintillation_time(fiber.scintillation_rise_time, fiber.scintillation_decay_time)
                               + propagation_time(l, fiber.light_velocity);
-            // Create photo-electron with truth hit ID and calculated arrival time
-            pes_container::photo_electron pe_(hit.GetId(), arrival_time);
+            // Create photo-electron with truth hit ID (if truth is on) and calculated arrival time
+            auto pe_ = m_truth ? pes_container::photo_electron(hit.GetId(), arrival_time)
+                               : pes_container::photo_electron(arrival_time);
             // Build complete channel ID from cell geometry
             channel_id chid = gecal.channel({cid, fl});
             // Store photo-electron in output collection
@@ -31,6 +31,8 @@ namespace sand::ecal {
    private:
     /// @brief Scintillation light yield (photons per MeV)
     double m_light_yield;
+    /// @brief Whether photo-electrons carry the ID of their hit
+    bool m_truth;
   };
 } // namespace sand::ecal
 
@@ -53,9 +53,9 @@ namespace sand {
     [[nodiscard]] static ::caf::SRTrueInteraction from_genie(const GRooTrackerEvent& event, const StdHep& stdhep);
 
     /// @return TrueParticleID for each added primary (use as ancestor_id for secondaries)
-    static std::vector<::caf::TrueParticleID> add_primaries(::caf::SRTrueInteraction& ixn,
-                                                            const std::vector<EDEPTrajectory>& primaries,
-                                                            std::size_t first_idx, std::size_t count);
+    static std::vector<::caf::TrueParticleID>
+    add_primaries(::caf::SRTrueInteraction& ixn, EDEPTrajectoryChildren<const EDEPTrajectory>::iterator first,
+                  EDEPTrajectoryChildren<const EDEPTrajectory>::iterator last);
 
     static void add_secondaries(::caf::SRTrueInteraction& ixn, EDEPTree::const_iterator begin,
                                 EDEPTree::const_iterator end, const ::caf::TrueParticleID& ancestor_id);
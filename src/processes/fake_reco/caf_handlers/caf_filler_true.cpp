@@ -162,13 +162,13 @@ namespace sand {
 
   std::vector<::caf::TrueParticleID>
   CAFFiller<::caf::SRTrueInteraction>::add_primaries(::caf::SRTrueInteraction& ixn,
-                                                     const std::vector<EDEPTrajectory>& primaries,
-                                                     std::size_t first_idx, std::size_t count) {
+                                                     EDEPTrajectoryChildren<const EDEPTrajectory>::iterator first,
+                                                     EDEPTrajectoryChildren<const EDEPTrajectory>::iterator last) {
     std::vector<::caf::TrueParticleID> ancestor_ids;
-    ancestor_ids.reserve(count);
+    ancestor_ids.reserve(std::distance(first, last));
 
-    for (std::size_t i{}; i != count; ++i) {
-      const auto& traj   = primaries[first_idx + i];
+    for (auto it = first; it != last; ++it) {
+      const auto& traj   = *it;
       const auto part_id = make_primary_id(ixn.id, static_cast<int>(ixn.prim.size()));
 
       ancestor_ids.push_back(part_id);
@@ -30,8 +30,9 @@ namespace sand {
 
     m_caf = &set<sand::caf::caf_wrapper>("output_caf");
 
-    const auto& primaries = m_edep->GetChildrenTrajectories();
-    const auto edep_map   = make_edep_interaction_map();
+    const auto primaries = m_edep->GetChildrenTrajectories();
+    const auto edep_map  = make_edep_interaction_map();
+    auto first_prim      = primaries.begin();
 
     // Initialize spill-level structures
     initialize_spill_capacities();
@@ -53,30 +54,25 @@ namespace sand {
       true_ixn.prim.reserve(prim_count);
 
       // Count secondaries for reservation
-      const auto* first_prim_ptr = primaries.data() + first_prim_idx;
-      const auto* last_prim_ptr  = primaries.data() + first_prim_idx + prim_count;
+      const auto last_prim = std::next(first_prim, prim_count);
       const std::size_t sec_count =
-          std::accumulate(first_prim_ptr, last_prim_ptr, std::size_t{0}, [this](std::size_t acc, const auto& prim) {
-            auto prim_it   = m_edep->GetTrajectory(prim.GetId());
-            auto sec_begin = std::next(prim_it);
-            auto sec_end   = m_edep->GetTrajectoryEnd(prim_it);
-            return acc + static_cast<std::size_t>(std::distance(sec_begin, sec_end));
-          });
+          std::accumulate(first_prim, last_prim, std::size_t{0},
+                          [](std::size_t acc, const auto& prim) { return acc + prim.GetSubtreeSize() - 1; });
       true_ixn.sec.reserve(sec_count);
 
       // Add primaries from edep-sim (returns ancestor IDs for secondaries)
-      auto ancestor_ids =
-          CAFFiller<::caf::SRTrueInteraction>::add_primaries(true_ixn, primaries, first_prim_idx, prim_count);
+      auto ancestor_ids = CAFFiller<::caf::SRTrueInteraction>::add_primaries(true_ixn, first_prim, last_prim);
 
       // Add secondaries for each primary
-      for (std::size_t i{}; i != prim_count; ++i) {
-        const auto& prim = primaries[first_prim_idx + i];
-        auto prim_it     = m_edep->GetTrajectory(prim.GetId());
-        auto sec_begin   = std::next(prim_it);
-        auto sec_end     = m_edep->GetTrajectoryEnd(prim_it);
+      std::size_t i{};
+      for (auto prim = first_prim; prim != last_prim; ++prim, ++i) {
+        auto prim_it   = m_edep->GetTrajectory(prim->GetId());
+        auto sec_begin = std::next(prim_it);
+        auto sec_end   = m_edep->GetTrajectoryEnd(prim_it);
 
         CAFFiller<::caf::SRTrueInteraction>::add_secondaries(true_ixn, sec_begin, sec_end, ancestor_ids[i]);
       }
+      first_prim = last_prim;
 
       // FAKE RECONSTRUCTION
       // Create fake reco interaction (common branch)
@@ -107,7 +103,7 @@ namespace sand {
   }
 
   std::vector<EdepInteractionRange> fake_reco::make_edep_interaction_map() const {
-    const auto& primaries = m_edep->GetChildrenTrajectories();
+    const auto primaries = m_edep->GetChildrenTrajectories();
     if (primaries.empty()) {
       UFW_WARN("No primary trajectories found in EDepSim event");
       return {};
@@ -116,17 +112,19 @@ namespace sand {
     std::vector<EdepInteractionRange> output;
     output.reserve(m_genie->events_.size());
 
-    std::size_t current_ixn = primaries[0].GetInteractionNumber();
+    std::size_t current_ixn = primaries.front().GetInteractionNumber();
     std::size_t range_begin{};
+    std::size_t i{};
 
-    for (std::size_t i{1}, primaries_size = primaries.size(); i != primaries_size; ++i) {
-      if (primaries[i].GetInteractionNumber() != current_ixn) {
+    for (const auto& prim : primaries) {
+      if (prim.GetInteractionNumber() != current_ixn) {
         output.push_back({range_begin, i - range_begin});
-        current_ixn = primaries[i].GetInteractionNumber();
+        current_ixn = prim.GetInteractionNumber();
         range_begin = i;
       }
+      ++i;
     }
-    output.push_back({range_begin, primaries.size() - range_begin});
+    output.push_back({range_begin, i - range_begin});
 
     UFW_ASSERT(output.size() == m_genie->events_.size(),
                "Mismatch between edep-sim interactions ({}) and GENIE events ({})", output.size(),
@@ -8,13 +8,34 @@
 #include <grain/digi.h>
 #include <grain/grain.h>
 #include <grain/photons.h>
+#include <truth_options/truth_options.hpp>
 
 #include <detector_response_fast.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
 UFW_REGISTER_DYNAMIC_PROCESS_FACTORY(sand::grain::detector_response_fast)
 
 namespace sand::grain {
 
+  namespace {
+
+    /// SplitMix64 finalizer, a bijection of 64 bits with good avalanche.
+    constexpr std::uint64_t mix64(std::uint64_t z) {
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      return z ^ (z >> 31);
+    }
+
+    /// Uniform number in [0, 1) at position counter of the stream key, independent of the order of the draws.
+    double counter_uniform(std::uint64_t key, std::uint64_t counter) {
+      return (mix64(key ^ mix64(counter + 0x9e3779b97f4a7c15ull)) >> 11) * 0x1.0p-53;
+    }
+
+  } // namespace
+
   detector_response_fast::detector_response_fast()
     : process({{"hits", "sand::grain::hits"}}, {{"digi", "sand::grain::digi"}}), m_uniform(0.0, 1.0) {
     UFW_DEBUG("Creating a detector_response_fast process at {}", fmt::ptr(this));
@@ -23,6 +44,11 @@ namespace sand::grain {
   void detector_response_fast::configure(const ufw::config& cfg) {
     process::configure(cfg);
     m_pde = cfg.at("pde");
+    m_truth = instance<truth_options>().enabled();
+    m_threads = cfg.value("threads", std::size_t{0});
+    m_seed    = cfg.value("seed", std::uint64_t{0});
+    m_counter = m_threads != 0 || cfg.contains("seed");
+    m_workers = m_threads == 0 ? nullptr : std::make_unique<utils::worker_pool>(m_threads);
   }
 
   void detector_response_fast::run() {
@@ -34,45 +60,145 @@ namespace sand::grain {
     m_stat_photons_discarded = 0;
     const auto& hits_in      = get<hits>("hits");
     UFW_DEBUG("Processing {} photon hits.", hits_in.photons.size());
-    auto& digi_out                        = set<digi>("digi");
-    for (const auto& photon : hits_in.photons) {
-      double interaction_probability = m_uniform(random_engine());
-      m_stat_photons_processed++;
-      const geoinfo::grain_info::camera& camera = gi.grain().at(photon.camera_id);
-      if (interaction_probability < m_pde) {
-        // UFW_DEBUG("processing photon with position: {}, {}", photon.pos.X(), photon.pos.Y());
-        bool channel_found = false;
-        for (int i = 0; i != camera_height && !channel_found; ++i) {
-          for (int j = 0; j != camera_width; ++j) {
-            if (photon.pos.X() > camera.sipm_active_areas[i][j].left
-                && photon.pos.X() < camera.sipm_active_areas[i][j].right
-                && photon.pos.Y() > camera.sipm_active_areas[i][j].bottom
-                && photon.pos.Y() < camera.sipm_active_areas[i][j].top) {
-              channel_id ch;
-              ch.subdetector = GRAIN;
-              ch.link        = photon.camera_id;
-              // consistent indexing: Row Major
-              ch.channel = i * camera_width + j;
-              digi::signal pe{reco::digi{sand::truth(photon.true_hit), ch, reco::digi::time{photon.pos.T()}}, photon.pos.T(), NAN, 1.0};
-              digi_out.signals.emplace_back(pe);
-              m_stat_photons_accepted++;
-              // UFW_DEBUG("Added photon to SiPM {},{}", i, j);
-              channel_found = true;
-              break;
-            }
-          }
-          if (channel_found) {
-            break;
+    auto& digi_out = set<digi>("digi");
+    // the grids are shared by the threads, build them all beforehand
+    for (const auto& camera : gi.grain().lens_cameras()) {
+      grid(gi.grain().at(camera.id));
+    }
+    for (const auto& camera : gi.grain().mask_cameras()) {
+      grid(gi.grain().at(camera.id));
+    }
+    const auto& photons   = hits_in.photons;
+    std::uint64_t context = ufw::context::current()->id();
+    auto key              = mix64(m_seed ^ mix64(context));
+    // each chunk is a contiguous range of photons, whose signals are appended in chunk order
+    std::size_t n_chunks = m_threads == 0 ? 1 : std::min(m_workers->size(), photons.size());
+    std::vector<digi::signal_collection> chunks(n_chunks);
+    auto detect_chunk = [&](std::size_t c) {
+      detect(gi.grain(), photons, photons.size() * c / n_chunks, photons.size() * (c + 1) / n_chunks, key, chunks[c]);
+    };
+    if (m_threads == 0) {
+      detect_chunk(0);
+    } else {
+      m_workers->parallel_for(n_chunks, detect_chunk);
+    }
+    std::size_t accepted = 0;
+    for (const auto& chunk : chunks) {
+      accepted += chunk.size();
+    }
+    digi_out.signals.reserve(digi_out.signals.size() + accepted);
+    for (auto& chunk : chunks) {
+      std::move(chunk.begin(), chunk.end(), std::back_inserter(digi_out.signals));
+    }
+    m_stat_photons_processed = photons.size();
+    m_stat_photons_accepted  = accepted;
+    m_stat_photons_discarded = photons.size() - accepted;
+    UFW_INFO("Processed {} photon hits; {} were accepted, {} discarded.", m_stat_photons_processed,
+             m_stat_photons_accepted, m_stat_photons_discarded);
+  }
+
+  /**
+   * Appends to signals those of the photons in [begin, end) absorbed in an active area. With m_counter, the draw of
+   * photon p is the p-th number of a counter-based stream keyed by the seed and the context, so the result does not
+   * depend on the number of threads nor on their scheduling, and ranges may be detected on any thread. Otherwise
+   * photons are drawn in order from the random engine of the process, on the calling thread.
+   */
+  void detector_response_fast::detect(const geoinfo::grain_info& grain, const std::vector<hits::photon>& photons,
+                                      std::size_t begin, std::size_t end, std::uint64_t key,
+                                      digi::signal_collection& signals) {
+    for (std::size_t p = begin; p != end; ++p) {
+      const auto& photon = photons[p];
+      double interaction_probability = m_counter ? counter_uniform(key, p) : m_uniform(random_engine());
+      if (!(interaction_probability < m_pde)) {
+        continue;
+      }
+      const auto& camera = grain.at(photon.camera_id);
+      int pixel          = find_pixel(camera, grid(camera), photon.pos.X(), photon.pos.Y());
+      if (pixel < 0) {
+        continue;
+      }
+      channel_id ch;
+      ch.subdetector = GRAIN;
+      ch.link        = photon.camera_id;
+      // consistent indexing: Row Major
+      ch.channel = pixel;
+      signals.push_back(digi::signal{
+          reco::digi{m_truth ? sand::truth(photon.true_hit) : sand::truth(), ch, reco::digi::time{photon.pos.T()}},
+          photon.pos.T(), NAN, 1.0});
+    }
+  }
+
+  detector_response_fast::sipm_grid detector_response_fast::make_grid(const geoinfo::grain_info::camera& camera) {
+    const auto& areas = camera.sipm_active_areas;
+    sipm_grid grid{false, areas[0][0].left, areas[0][0].top, double(areas[0][1].left) - areas[0][0].left,
+                   double(areas[0][0].top) - areas[1][0].top};
+    if (!(grid.pitch_x > 0.) || !(grid.pitch_y > 0.)) {
+      return grid;
+    }
+    // the areas are accumulated in single precision, allow for some rounding
+    const double tolerance = 1e-3 * std::min(grid.pitch_x, grid.pitch_y);
+    for (int i = 0; i != camera_height; ++i) {
+      for (int j = 0; j != camera_width; ++j) {
+        if (!(std::abs(areas[i][j].left - (grid.left + j * grid.pitch_x)) <= tolerance)
+            || !(std::abs(areas[i][j].top - (grid.top - i * grid.pitch_y)) <= tolerance)) {
+          return grid;
+        }
+      }
+    }
+    grid.regular = true;
+    return grid;
+  }
+
+  const detector_response_fast::sipm_grid& detector_response_fast::grid(const geoinfo::grain_info::camera& camera) {
+    auto it = m_grids.find(camera.id);
+    if (it == m_grids.end()) {
+      it = m_grids.emplace(camera.id, make_grid(camera)).first;
+      if (!it->second.regular) {
+        UFW_WARN("SiPMs of camera '{}' are not on a regular grid, pixels will be searched linearly.", camera.name);
+      }
+    }
+    return it->second;
+  }
+
+  /**
+   * Channel of the SiPM whose active area contains (x, y), or -1 if the position is in a dead region. On a regular
+   * grid only the pixel the position falls in and its neighbours, which rounding may have shifted it into, are tested.
+   */
+  int detector_response_fast::find_pixel(const geoinfo::grain_info::camera& camera, const sipm_grid& grid, double x,
+                                         double y) {
+    constexpr int height = camera_height;
+    constexpr int width  = camera_width;
+    const auto& areas    = camera.sipm_active_areas;
+    auto inside          = [&](int i, int j) {
+      return x > areas[i][j].left && x < areas[i][j].right && y > areas[i][j].bottom && y < areas[i][j].top;
+    };
+    if (!grid.regular) {
+      for (int i = 0; i != height; ++i) {
+        for (int j = 0; j != width; ++j) {
+          if (inside(i, j)) {
+            return i * width + j;
           }
         }
-        if (channel_found == false) {
-          m_stat_photons_discarded++;
+      }
+      return -1;
+    }
+    double col = std::floor((x - grid.left) / grid.pitch_x);
+    double row = std::floor((grid.top - y) / grid.pitch_y);
+    if (!(col >= -1. && col <= width && row >= -1. && row <= height)) {
+      return -1;
+    }
+    int i0 = int(row);
+    int j0 = int(col);
+    if (i0 >= 0 && i0 < height && j0 >= 0 && j0 < width && inside(i0, j0)) {
+      return i0 * width + j0;
+    }
+    for (int i = std::max(i0 - 1, 0); i <= std::min(i0 + 1, height - 1); ++i) {
+      for (int j = std::max(j0 - 1, 0); j <= std::min(j0 + 1, width - 1); ++j) {
+        if (inside(i, j)) {
+          return i * width + j;
         }
-      } else {
-        m_stat_photons_discarded++;
       }
     }
-    UFW_INFO("Processed {} photon hits; {} were accepted, {} discarded.", m_stat_photons_processed,
-             m_stat_photons_accepted, m_stat_photons_discarded);
+    return -1;
   }
 } // namespace sand::grain
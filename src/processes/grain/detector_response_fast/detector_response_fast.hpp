@@ -4,9 +4,17 @@
 #include <ufw/factory.hpp>
 #include <ufw/process.hpp>
 
+#include <common/utils/worker_pool.h>
+#include <geoinfo/geoinfo.hpp>
+#include <geoinfo/grain_info.hpp>
 #include <grain/digi.h>
 #include <grain/photons.h>
 
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
 namespace sand::grain {
 
   class detector_response_fast : public ufw::process {
@@ -15,12 +23,39 @@ namespace sand::grain {
     void configure(const ufw::config& cfg) override;
     void run() override;
 
+   private:
+    /**
+     * Layout of the SiPM active areas of a camera as a regular grid: pixel (i, j) starts at left + j * pitch_x and
+     * top - i * pitch_y. It is only used to guess the pixel of a position, the active areas themselves are always
+     * checked, so cameras whose areas are not on a grid are only slower.
+     */
+    struct sipm_grid {
+      bool regular;
+      double left;
+      double top;
+      double pitch_x;
+      double pitch_y;
+    };
+
+    static sipm_grid make_grid(const geoinfo::grain_info::camera&);
+    static int find_pixel(const geoinfo::grain_info::camera&, const sipm_grid&, double x, double y);
+    const sipm_grid& grid(const geoinfo::grain_info::camera&);
+    void detect(const geoinfo::grain_info&, const std::vector<hits::photon>&, std::size_t begin, std::size_t end,
+                std::uint64_t key, digi::signal_collection& signals);
+
    private:
     double m_pde;
+    bool m_truth;          ///< Whether signals carry the hit of their photon.
+    std::size_t m_threads; ///< Threads detecting the photons, 0 for the calling one only.
+    std::uint64_t m_seed;  ///< Seed of the counter-based streams, combined with the context id.
+    bool m_counter;        ///< Whether photons are drawn from counter-based streams, as with a seed or threads.
+    /// Threads of detect_parallel, started in configure and reused by every run.
+    std::unique_ptr<utils::worker_pool> m_workers;
     std::uniform_real_distribution<> m_uniform;
     uint64_t m_stat_photons_processed;
     uint64_t m_stat_photons_accepted;
     uint64_t m_stat_photons_discarded;
+    std::unordered_map<channel_id::link_t, sipm_grid> m_grids;
   };
 
 } // namespace sand::grain
@@ -0,0 +1,53 @@
+#include <ufw/config.hpp>
+#include <ufw/context.hpp>
+#include <ufw/data.hpp>
+#include <ufw/factory.hpp>
+#include <ufw/process.hpp>
+
+#include <common/utils/compare.h>
+#include <grain/digi.h>
+
+namespace sand::grain {
+
+  /**
+   * Checks that two GRAIN digi products are identical, signal by signal: channel, times, amplitude and truth. Used to
+   * check that configurations which must not change the output, e.g. the number of threads, do not.
+   */
+  class digi_test : public ufw::process {
+   public:
+    digi_test();
+    void configure(const ufw::config& cfg) override;
+    void run() override;
+  };
+
+  namespace {
+
+    bool same_signal(const digi::signal& a, const digi::signal& b) {
+      using utils::same;
+      return a.channel() == b.channel() && same(a.t().earliest(), b.t().earliest()) && same(a.t().best(), b.t().best())
+          && same(a.t().latest(), b.t().latest())
+          && same(a.time_rising_edge, b.time_rising_edge) && same(a.time_over_threshold, b.time_over_threshold)
+          && same(a.npe, b.npe) && utils::same_truth(a, b);
+    }
+
+  } // namespace
+
+  void digi_test::configure(const ufw::config& cfg) {
+    process::configure(cfg);
+    UFW_INFO("Configuring digi_test at {}.", fmt::ptr(this));
+  }
+
+  digi_test::digi_test() : process({{"digi", "sand::grain::digi"}, {"reference", "sand::grain::digi"}}, {}) {
+    UFW_INFO("Creating a digi_test process at {}.", fmt::ptr(this));
+  }
+
+  void digi_test::run() {
+    const auto& signals = get<digi>("digi").signals;
+    utils::check_same(signals, get<digi>("reference").signals, same_signal, "signals");
+    UFW_INFO("Digi matches the reference: {} signals.", signals.size());
+  }
+
+} // namespace sand::grain
+
+UFW_REGISTER_PROCESS(sand::grain::digi_test)
+UFW_REGISTER_DYNAMIC_PROCESS_FACTORY(sand::grain::digi_test)
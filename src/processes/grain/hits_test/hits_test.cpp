@@ -0,0 +1,51 @@
+#include <ufw/config.hpp>
+#include <ufw/context.hpp>
+#include <ufw/data.hpp>
+#include <ufw/factory.hpp>
+#include <ufw/process.hpp>
+
+#include <common/utils/compare.h>
+#include <grain/photons.h>
+
+namespace sand::grain {
+
+  /**
+   * Checks that two GRAIN hits products are identical, photon by photon: truth, position, origin, momentum, scattering
+   * and camera. Used to check that configurations which must not change the optical simulation, e.g. the number of
+   * Geant4 threads, do not.
+   */
+  class hits_test : public ufw::process {
+   public:
+    hits_test();
+    void configure(const ufw::config& cfg) override;
+    void run() override;
+  };
+
+  namespace {
+
+    bool same_photon(const hits::photon& a, const hits::photon& b) {
+      return a.true_hit == b.true_hit && a.pos == b.pos && a.origin == b.origin && a.p == b.p
+          && utils::same(a.scatter, b.scatter) && a.inside_camera == b.inside_camera && a.camera_id == b.camera_id;
+    }
+
+  } // namespace
+
+  void hits_test::configure(const ufw::config& cfg) {
+    process::configure(cfg);
+    UFW_INFO("Configuring hits_test at {}.", fmt::ptr(this));
+  }
+
+  hits_test::hits_test() : process({{"hits", "sand::grain::hits"}, {"reference", "sand::grain::hits"}}, {}) {
+    UFW_INFO("Creating a hits_test process at {}.", fmt::ptr(this));
+  }
+
+  void hits_test::run() {
+    const auto& photons = get<hits>("hits").photons;
+    utils::check_same(photons, get<hits>("reference").photons, same_photon, "photons");
+    UFW_INFO("Hits match the reference: {} photons.", photons.size());
+  }
+
+} // namespace sand::grain
+
+UFW_REGISTER_PROCESS(sand::grain::hits_test)
+UFW_REGISTER_DYNAMIC_PROCESS_FACTORY(sand::grain::hits_test)
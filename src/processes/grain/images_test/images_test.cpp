@@ -0,0 +1,109 @@
+#include <ufw/config.hpp>
+#include <ufw/context.hpp>
+#include <ufw/data.hpp>
+#include <ufw/factory.hpp>
+#include <ufw/process.hpp>
+
+#include <common/utils/compare.h>
+#include <grain/digi.h>
+#include <grain/image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace sand::grain {
+
+  /**
+   * Checks the images built by a spill_slicer against images rebuilt from its digi, one slice at a time, by going
+   * through all the signals for each slice. Every slice must have an image for each camera with signals, in order of
+   * their first signal, and their pixels must be identical: amplitude, time of the first signal and truth, the latter
+   * read through the truth pool of the spill_slicer.
+   */
+  class images_test : public ufw::process {
+   public:
+    images_test();
+    void configure(const ufw::config& cfg) override;
+    void run() override;
+  };
+
+  namespace {
+
+    images::image_list rebuild(const digi& digis_in, const std::vector<std::pair<double, double>>& slices,
+                               truth_pool& truths) {
+      images::image_list images_out;
+      for (const auto& [begin, end] : slices) {
+        size_t offset = images_out.size();
+        for (const auto& signal : digis_in.signals) {
+          auto id = signal.channel().link;
+          auto it = std::find_if(images_out.begin() + offset, images_out.end(),
+                                 [id](const auto& img) { return img.camera_id == id; });
+          if (it == images_out.end()) {
+            images_out.emplace_back(images::image{id, begin, end});
+            it = images_out.end() - 1;
+            it->blank();
+          }
+          if (signal.time_rising_edge >= begin && signal.time_rising_edge < end) {
+            auto& pixel = it->pixels.Array()[signal.channel().channel];
+            truths.insert(pixel, signal);
+            pixel.amplitude += signal.npe;
+            if (std::isnan(pixel.time_first) || (pixel.time_first > signal.time_rising_edge)) {
+              pixel.time_first = signal.time_rising_edge;
+            }
+          }
+        }
+      }
+      return images_out;
+    }
+
+    bool same_image(const images::image& a, const truth_pool& truths_a, const images::image& b,
+                    const truth_pool& truths_b) {
+      if (a.camera_id != b.camera_id || a.time_begin != b.time_begin || a.time_end != b.time_end) {
+        return false;
+      }
+      for (std::size_t p = 0; p != camera_height * camera_width; ++p) {
+        const auto& pa = a.pixels.Array()[p];
+        const auto& pb = b.pixels.Array()[p];
+        if (!utils::same(pa.amplitude, pb.amplitude) || !utils::same(pa.time_first, pb.time_first)
+            || !utils::same_truth(pa, truths_a, pb, truths_b)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+  } // namespace
+
+  void images_test::configure(const ufw::config& cfg) {
+    process::configure(cfg);
+    UFW_INFO("Configuring images_test at {}.", fmt::ptr(this));
+  }
+
+  images_test::images_test()
+      : process({{"digi", "sand::grain::digi"}, {"images", "sand::grain::images"}, {"truth", "sand::truth_pool"}}, {}) {
+    UFW_INFO("Creating an images_test process at {}.", fmt::ptr(this));
+  }
+
+  void images_test::run() {
+    const auto& digis_in = get<digi>("digi");
+    const auto& sliced   = get<images>("images").images;
+    std::vector<std::pair<double, double>> slices;
+    for (const auto& img : sliced) {
+      if (slices.empty() || slices.back() != std::make_pair(img.time_begin, img.time_end)) {
+        slices.emplace_back(img.time_begin, img.time_end);
+      }
+    }
+    const auto& truths = get<truth_pool>("truth");
+    truth_pool rebuilt_truths;
+    auto rebuilt = rebuild(digis_in, slices, rebuilt_truths);
+    utils::check_same(
+        sliced, rebuilt,
+        [&](const auto& a, const auto& b) { return same_image(a, truths, b, rebuilt_truths); }, "images");
+    UFW_INFO("Images match the expected ones: {} images in {} slices.", sliced.size(), slices.size());
+  }
+
+} // namespace sand::grain
+
+UFW_REGISTER_PROCESS(sand::grain::images_test)
+UFW_REGISTER_DYNAMIC_PROCESS_FACTORY(sand::grain::images_test)
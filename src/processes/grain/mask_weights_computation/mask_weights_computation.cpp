@@ -6,9 +6,11 @@
 
 #include <ocl/ocl.hpp>
 
-#include <chrono>
+#include <algorithm>
+#include <deque>
 #include <random>
 #include <string>
+#include <vector>
 
 #include <geoinfo/grain_info.hpp>
 #include <hdf5/hdf5.hpp>
@@ -24,14 +26,29 @@ namespace sand::grain {
     void run() override;
 
    private:
+    /// Kernels and buffers of one queue, reused by all the cameras it processes.
+    struct device_pipeline {
+      cl::CommandQueue* queue = nullptr;
+      cl::Kernel frustum_kernel;
+      cl::Kernel solidangle_kernel;
+      cl::buffer sensor_rects;
+      cl::buffer mask_rects;
+      cl::buffer frustum;
+      std::vector<cl::buffer> solidangles; ///< Two when they fit in the device memory, so that cameras overlap.
+    };
+
     void configure_frustum(cl::platform& platform);
     void configure_solidangle(cl::platform& platform);
+    std::vector<device_pipeline> make_pipelines(cl::platform& platform, size_t max_holes, size_t solidangle_size);
+    cl::Events enqueue_camera(device_pipeline& pipeline, cl::buffer& buf_solidangles,
+                              const geoinfo::grain_info::mask_camera& camera, const transform_t& voxel_transform,
+                              const cl::NDRange& solidangle_global_size);
     solidangle_cfg m_solidangle_cfg;
+    bool m_sparse;
+    float m_sparse_threshold;
     static constexpr size_t s_max_platforms = 4;
     cl::Program m_frustum_program;
-    cl::Kernel m_frustum_kernel;
     cl::Program m_solidangle_program;
-    cl::Kernel m_solidangle_kernel;
   };
 
   void mask_weights_computation::configure_frustum(cl::platform& platform) {
@@ -41,7 +58,6 @@ namespace sand::grain {
 #include "cl_src/make_frustum.cl"
         ;
     platform.build_program(m_frustum_program, frustum_kernel_src);
-    m_frustum_kernel = cl::Kernel(m_frustum_program, "make_frustum");
   }
 
   void mask_weights_computation::configure_solidangle(cl::platform& platform) {
@@ -51,13 +67,14 @@ namespace sand::grain {
 #include "cl_src/solidangle.cl"
         ;
     platform.build_program(m_solidangle_program, solidangle_kernel_src);
-    m_solidangle_kernel = cl::Kernel(m_solidangle_program, "solidangle");
   }
 
   void mask_weights_computation::configure(const ufw::config& cfg) {
     process::configure(cfg);
     m_solidangle_cfg = {cfg.at("voxel_size"), cfg.at("lar_attenuation_length"), cfg.at("pde"),
                         cfg.at("minivoxels_per_side")};
+    m_sparse           = cfg.value("sparse", false);
+    m_sparse_threshold = cfg.value("sparse_threshold", 0.f);
     auto& platform   = instance<cl::platform>();
     configure_frustum(platform);
     configure_solidangle(platform);
@@ -67,6 +84,127 @@ namespace sand::grain {
     UFW_DEBUG("Creating an mask_weights_computation process at {}.", fmt::ptr(this));
   }
 
+  /**
+   * One pipeline per queue, all with the same number of output buffers: two if every device has the memory for them,
+   * one otherwise, in which case a device waits for each camera to be written before starting the next one.
+   */
+  std::vector<mask_weights_computation::device_pipeline>
+  mask_weights_computation::make_pipelines(cl::platform& platform, size_t max_holes, size_t solidangle_size) {
+    const size_t sensor_rects_size  = camera_height * camera_width;
+    const size_t sensor_rects_bytes = sensor_rects_size * sizeof(geoinfo::grain_info::rect_f);
+    const size_t mask_rects_bytes   = max_holes * sizeof(geoinfo::grain_info::rect_f);
+    const size_t frustum_bytes      = max_holes * sensor_rects_size * sizeof(frustum_t);
+    const size_t solidangle_bytes   = solidangle_size * sizeof(cl_float);
+    const size_t inputs_bytes       = sensor_rects_bytes + mask_rects_bytes + frustum_bytes;
+
+    size_t n_outputs = 2;
+    for (const auto& device : platform.devices()) {
+      std::string name   = device.getInfo<CL_DEVICE_NAME>();
+      cl_ulong max_alloc = device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>();
+      cl_ulong global    = device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>();
+      if (std::max(frustum_bytes, solidangle_bytes) > max_alloc) {
+        UFW_ERROR("Device {} allocates at most {} MB per buffer, {} MB are needed.", name, max_alloc >> 20,
+                  std::max(frustum_bytes, solidangle_bytes) >> 20);
+      }
+      if (inputs_bytes + solidangle_bytes > global) {
+        UFW_ERROR("Device {} has {} MB of global memory, {} MB are needed.", name, global >> 20,
+                  (inputs_bytes + solidangle_bytes) >> 20);
+      }
+      if (n_outputs == 2 && inputs_bytes + 2 * solidangle_bytes > global) {
+        UFW_WARN("Device {} has {} MB of global memory, not enough for two output buffers of {} MB: using one.", name,
+                 global >> 20, solidangle_bytes >> 20);
+        n_outputs = 1;
+      }
+    }
+
+    std::vector<device_pipeline> pipelines(platform.queues().size());
+    for (size_t i = 0; i != pipelines.size(); ++i) {
+      auto& pipeline = pipelines[i];
+      pipeline.queue = &platform.queues()[i];
+      // Kernel arguments are per kernel object, each queue needs its own.
+      pipeline.frustum_kernel    = cl::Kernel(m_frustum_program, "make_frustum");
+      pipeline.solidangle_kernel = cl::Kernel(m_solidangle_program, "solidangle");
+      pipeline.sensor_rects.allocate<CL_MEM_READ_ONLY>(platform.context(), sensor_rects_bytes);
+      pipeline.mask_rects.allocate<CL_MEM_READ_ONLY>(platform.context(), mask_rects_bytes);
+      pipeline.frustum.allocate<CL_MEM_READ_WRITE>(platform.context(), frustum_bytes);
+      pipeline.solidangles.resize(n_outputs);
+      for (auto& solidangles : pipeline.solidangles) {
+        solidangles.allocate<CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR | CL_MEM_HOST_READ_ONLY>(platform.context(),
+                                                                                                solidangle_bytes);
+      }
+    }
+    return pipelines;
+  }
+
+  /**
+   * Enqueues the kernels of a camera and returns their events, the solid angle one last.
+   */
+  cl::Events mask_weights_computation::enqueue_camera(device_pipeline& pipeline, cl::buffer& buf_solidangles,
+                                                      const geoinfo::grain_info::mask_camera& camera,
+                                                      const transform_t& voxel_transform,
+                                                      const cl::NDRange& solidangle_global_size) {
+    const size_t sensor_rects_size = camera_height * camera_width;
+    const size_t mask_rects_size   = camera.holes.size();
+    auto& queue                    = *pipeline.queue;
+
+    transform_t camera_transform = to_ocl_xform(camera.transform);
+
+    cl_float z_mask    = static_cast<cl_float>(camera.z_mask);
+    cl_float z_sensors = static_cast<cl_float>(camera.z_sipm);
+
+    // The source arrays belong to geoinfo and outlive the copies, the queue is in order so the previous camera is done
+    // with the buffers before they are overwritten.
+    cl::Event ev_sensor_rects = pipeline.sensor_rects.write(camera.sipm_active_areas.Array(), queue, 0,
+                                                            sensor_rects_size * sizeof(geoinfo::grain_info::rect_f));
+    cl::Event ev_mask_rects =
+        pipeline.mask_rects.write(camera.holes.data(), queue, 0, mask_rects_size * sizeof(geoinfo::grain_info::rect_f));
+
+    // set kernel args
+    try {
+      pipeline.frustum_kernel.setArg(0, camera_transform);
+      pipeline.frustum_kernel.setArg(1, 0);
+      pipeline.frustum_kernel.setArg(2, pipeline.mask_rects);
+      pipeline.frustum_kernel.setArg(3, z_mask);
+      pipeline.frustum_kernel.setArg(4, pipeline.sensor_rects);
+      pipeline.frustum_kernel.setArg(5, z_sensors);
+      pipeline.frustum_kernel.setArg(6, pipeline.frustum);
+    } catch (const cl::Error& e) {
+      UFW_WARN("OpenCL make_frustum Program Kernel setArg: {} ({})", e.what(), e.err());
+      throw;
+    }
+
+    cl::NDRange global_size(mask_rects_size, sensor_rects_size);
+    UFW_DEBUG("Frustum global work size: ({},{})", global_size[0], global_size[1]);
+    cl::Events frustum_prereq{ev_sensor_rects, ev_mask_rects};
+    cl::Event ev_frustum_kernel_execution;
+    queue.enqueueNDRangeKernel(pipeline.frustum_kernel, cl::NullRange, global_size, cl::NullRange, &frustum_prereq,
+                               &ev_frustum_kernel_execution);
+
+    // set kernel args
+    try {
+      pipeline.solidangle_kernel.setArg(0, voxel_transform);
+      pipeline.solidangle_kernel.setArg(1, camera_transform);
+      pipeline.solidangle_kernel.setArg(2, pipeline.frustum);
+      pipeline.solidangle_kernel.setArg(3, static_cast<int>(mask_rects_size));
+      pipeline.solidangle_kernel.setArg(4, pipeline.mask_rects);
+      pipeline.solidangle_kernel.setArg(5, z_mask);
+      pipeline.solidangle_kernel.setArg(6, static_cast<int>(sensor_rects_size));
+      pipeline.solidangle_kernel.setArg(7, pipeline.sensor_rects);
+      pipeline.solidangle_kernel.setArg(8, z_sensors);
+      pipeline.solidangle_kernel.setArg(9, m_solidangle_cfg);
+      pipeline.solidangle_kernel.setArg(10, buf_solidangles);
+    } catch (const cl::Error& e) {
+      UFW_WARN("OpenCL solidangle Program Kernel setArg: {} ({})", e.what(), e.err());
+      throw;
+    }
+
+    cl::Events solidangle_prereq{ev_frustum_kernel_execution};
+    cl::Event ev_solidangle_kernel_execution;
+    queue.enqueueNDRangeKernel(pipeline.solidangle_kernel, cl::NullRange, solidangle_global_size, cl::NullRange,
+                               &solidangle_prereq, &ev_solidangle_kernel_execution);
+    return {ev_frustum_kernel_execution, ev_solidangle_kernel_execution};
+  }
+
   void mask_weights_computation::run() {
     UFW_DEBUG("Running an mask_weights_computation process at {}.", fmt::ptr(this));
     auto& platform = instance<cl::platform>();
@@ -81,7 +219,7 @@ namespace sand::grain {
 
     cl::NDRange solidangle_global_size(voxels.size().x(), voxels.size().y(), voxels.size().z());
     UFW_DEBUG("Solidangle global work size: ({},{},{})", solidangle_global_size[0], solidangle_global_size[1],
-             solidangle_global_size[2]);
+              solidangle_global_size[2]);
 
     // Setup output file
     auto& array = instance<sand::hdf5::ndarray>("angle_writer");
@@ -89,93 +227,68 @@ namespace sand::grain {
         {solidangle_global_size[0], solidangle_global_size[1], solidangle_global_size[2], sensor_rects_size});
     range.set_type(H5::PredType::NATIVE_FLOAT);
 
-    for (const auto& camera : gi.grain().mask_cameras()) {
+    const auto& cameras = gi.grain().mask_cameras();
+    size_t max_holes    = 1;
+    for (const auto& camera : cameras) {
+      max_holes = std::max(max_holes, camera.holes.size());
+    }
+    auto pipelines = make_pipelines(platform, max_holes, solidangle_size);
+
+    // Cameras are dealt round robin to the devices, and each device has up to two output buffers: while a camera is
+    // being written to file, the next camera of the same device is already running. Results are read back by mapping
+    // the output buffers, which live in pinned host memory where the implementation supports it. Writing happens here,
+    // in camera order, as HDF5 is not thread safe.
+    struct in_flight {
+      const geoinfo::grain_info::mask_camera* camera;
+      cl::buffer::mapped_ptr solidangles;
+      cl::Events kernels;
+    };
+    const size_t n_pipelines = pipelines.size();
+    const size_t n_outputs   = pipelines.empty() ? 0 : pipelines.front().solidangles.size();
+    const size_t depth       = n_outputs * n_pipelines;
+    std::deque<in_flight> pending;
+    auto submit = [&](size_t index) {
+      const auto& camera = cameras[index];
+      auto& pipeline     = pipelines[index % n_pipelines];
+      auto& output       = pipeline.solidangles[(index / n_pipelines) % n_outputs];
       UFW_INFO("Processing camera: {}", camera.name);
-      auto t_start = std::chrono::high_resolution_clock::now();
-
-      const size_t mask_rects_size    = camera.holes.size();
-      const size_t frustum_array_size = sensor_rects_size * mask_rects_size;
-      std::unique_ptr<frustum_t[]> h_frustum_array(new frustum_t[frustum_array_size]);
-
-      transform_t camera_transform = to_ocl_xform(camera.transform);
-
-      cl_float z_mask    = static_cast<cl_float>(camera.z_mask);
-      cl_float z_sensors = static_cast<cl_float>(camera.z_sipm);
-
-      cl::buffer buf_sensor_rects;
-      buf_sensor_rects.allocate<CL_MEM_COPY_HOST_PTR | CL_MEM_READ_ONLY>(
-          platform.context(), sensor_rects_size * sizeof(geoinfo::grain_info::rect_f),
-          camera.sipm_active_areas.Array());
-
-      cl::buffer buf_mask_rects;
-      buf_mask_rects.allocate<CL_MEM_COPY_HOST_PTR | CL_MEM_READ_ONLY>(
-          platform.context(), mask_rects_size * sizeof(geoinfo::grain_info::rect_f), camera.holes.data());
-
-      cl::buffer buf_frustum;
-      buf_frustum.allocate<CL_MEM_READ_WRITE>(platform.context(), frustum_array_size * sizeof(frustum_t));
-
-      // set kernel args
-      try {
-        m_frustum_kernel.setArg(0, camera_transform);
-        m_frustum_kernel.setArg(1, 0);
-        m_frustum_kernel.setArg(2, buf_mask_rects);
-        m_frustum_kernel.setArg(3, z_mask);
-        m_frustum_kernel.setArg(4, buf_sensor_rects);
-        m_frustum_kernel.setArg(5, z_sensors);
-        m_frustum_kernel.setArg(6, buf_frustum);
-      } catch (const cl::Error& e) {
-        UFW_WARN("OpenCL make_frustum Program Kernel setArg: {} ({})", e.what(), e.err());
-        throw;
-      }
+      cl::Events kernels = enqueue_camera(pipeline, output, camera, voxel_transform, solidangle_global_size);
+      // The map is enqueued right away, so that it does not wait for the next camera on the same queue.
+      auto solidangles   = output.map<CL_MAP_READ>(*pipeline.queue, 0, -1ul, {kernels.back()});
+      pending.push_back({&camera, std::move(solidangles), std::move(kernels)});
+      pipeline.queue->flush();
+    };
 
-      cl::NDRange global_size(mask_rects_size, sensor_rects_size);
-      UFW_DEBUG("Frustum global work size: ({},{})", global_size[0], global_size[1]);
-      cl::Event ev_frustum_kernel_execution;
-      platform.queues().front().enqueueNDRangeKernel(m_frustum_kernel, cl::NullRange, cl::NDRange(global_size),
-                                                     cl::NullRange, nullptr, &ev_frustum_kernel_execution);
-      void* frustum_p = h_frustum_array.get();
-      cl::Event ev_copy_frustum_from_device =
-          buf_frustum.read(frustum_p, platform.queues().front(), 0, -1, {ev_frustum_kernel_execution});
-
-      platform.queues().front().finish();
-
-      std::unique_ptr<float[]> h_solidangle_array(new float[solidangle_size]);
-      cl::buffer buf_solidangles;
-      buf_solidangles.allocate<CL_MEM_WRITE_ONLY>(platform.context(), solidangle_size * sizeof(cl_float));
-
-      // set kernel args
-      try {
-        m_solidangle_kernel.setArg(0, voxel_transform);
-        m_solidangle_kernel.setArg(1, camera_transform);
-        m_solidangle_kernel.setArg(2, buf_frustum);
-        m_solidangle_kernel.setArg(3, static_cast<int>(mask_rects_size));
-        m_solidangle_kernel.setArg(4, buf_mask_rects);
-        m_solidangle_kernel.setArg(5, z_mask);
-        m_solidangle_kernel.setArg(6, static_cast<int>(sensor_rects_size));
-        m_solidangle_kernel.setArg(7, buf_sensor_rects);
-        m_solidangle_kernel.setArg(8, z_sensors);
-        m_solidangle_kernel.setArg(9, m_solidangle_cfg);
-        m_solidangle_kernel.setArg(10, buf_solidangles);
-      } catch (const cl::Error& e) {
-        UFW_WARN("OpenCL solidangle Program Kernel setArg: {} ({})", e.what(), e.err());
-        throw;
+    size_t submitted = 0;
+    for (; submitted != std::min(depth, cameras.size()); ++submitted) {
+      submit(submitted);
+    }
+    while (!pending.empty()) {
+      {
+        auto& current = pending.front();
+        // Write to hdf5
+        if (m_sparse) {
+          auto matrix = sand::hdf5::ndarray::sparse_matrix::compress(
+              range, static_cast<const float*>(current.solidangles.get()), m_sparse_threshold);
+          UFW_DEBUG("{} keeps {} of {} weights.", current.camera->name, matrix.values.size(), range.flat_size());
+          array.write_sparse(current.camera->name, matrix);
+        } else {
+          array.write(current.camera->name, range, current.solidangles.get());
+        }
+        // The kernels are done once the map is, the profiling counters time them on the device alone.
+        double frustum_ms    = cl::elapsed_time(current.kernels.front());
+        double solidangle_ms = cl::elapsed_time(current.kernels.back());
+        UFW_INFO("{} completed, kernel time: {} ms (frustum {} ms, solid angles {} ms)", current.camera->name,
+                 frustum_ms + solidangle_ms, frustum_ms, solidangle_ms);
       }
-
-      cl::Event ev_solidangle_kernel_execution;
-      platform.queues().front().enqueueNDRangeKernel(m_solidangle_kernel, cl::NullRange,
-                                                     cl::NDRange(solidangle_global_size), cl::NullRange, nullptr,
-                                                     &ev_solidangle_kernel_execution);
-      void* solidangle_p = h_solidangle_array.get();
-      cl::Event ev_copy_solidangle_from_device =
-          buf_solidangles.read(solidangle_p, platform.queues().front(), 0, -1, {ev_solidangle_kernel_execution});
-
-      platform.queues().front().finish();
-
-      // Write to hdf5
-      array.write(camera.name, range, h_solidangle_array.get());
-      auto t_stop = std::chrono::high_resolution_clock::now();
-      double elapsed_time = std::chrono::duration<double>(t_stop - t_start).count();
-      UFW_INFO("{} completed, time taken: {} s", camera.name, elapsed_time);
+      // Unmapping is queued before the next use of the same output buffer.
+      pending.pop_front();
+      if (submitted != cameras.size()) {
+        submit(submitted++);
+      }
+    }
+    for (auto& pipeline : pipelines) {
+      pipeline.queue->finish();
     }
   }
 } // namespace sand::grain
@@ -35,20 +35,25 @@
 
 namespace sand::grain {
 
-ActionInitialization::ActionInitialization(AnalysisManager* mgr, optical_simulation* optmen_edepsim)
+ActionInitialization::ActionInitialization(optical_simulation* optmen_edepsim)
  : G4VUserActionInitialization(), m_optmen_edepsim(optmen_edepsim)
-{
-  _anMgr = mgr;
-}
+{}
 
 ActionInitialization::~ActionInitialization()
 {}
 
+void ActionInitialization::BuildForMaster() const
+{
+  SetUserAction(new RunAction(new AnalysisManager(m_optmen_edepsim)));
+}
+
+// Called once per worker thread in multi-threaded mode, so every worker has its own analysis manager.
 void ActionInitialization::Build() const
 {
+  AnalysisManager* anMgr = new AnalysisManager(m_optmen_edepsim);
   SetUserAction(new PrimaryGeneratorAction(m_optmen_edepsim));
-  SetUserAction(new RunAction(_anMgr));
-  SetUserAction(new EventAction(_anMgr));
-  SetUserAction(new StackingAction(_anMgr));
+  SetUserAction(new RunAction(anMgr));
+  SetUserAction(new EventAction(anMgr));
+  SetUserAction(new StackingAction(anMgr));
 }  
 }
\ No newline at end of file
@@ -39,13 +39,13 @@ namespace sand::grain {
 class ActionInitialization : public G4VUserActionInitialization
 {
   public:
-    ActionInitialization(AnalysisManager* mgr, optical_simulation* optmen_edepsim);
+    ActionInitialization(optical_simulation* optmen_edepsim);
     virtual ~ActionInitialization();
 
+    virtual void BuildForMaster() const;
     virtual void Build() const;
 
   private:
-    AnalysisManager *_anMgr;
     optical_simulation* m_optmen_edepsim;
 };
 }
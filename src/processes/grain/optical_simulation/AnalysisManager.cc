@@ -1,12 +1,11 @@
 #include <ufw/utils.hpp>
-#include <ufw/context.hpp>
 #include <grain/photons.h>
-#include <geoinfo/grain_info.hpp>
 
 #include <optical_simulation.hpp>
 
 #include <G4Event.hh>
 #include <G4HCofThisEvent.hh>
+#include <G4HCtable.hh>
 #include <G4SDManager.hh>
 #include <G4THitsCollection.hh>
 #include "AnalysisManager.hh"
@@ -20,10 +19,16 @@ AnalysisManager::~AnalysisManager() {}
 void AnalysisManager::BeginOfRun() {
   UFW_DEBUG("Begin of run");
   if (sensorCollID.size() == 0) {
-    //nicko: What is the purpose of this??
+    // the sensors are known once the detector is constructed: keep the ids of their collections, skipping the argon
     G4SDManager* pSDManager = G4SDManager::GetSDMpointer();
+    G4HCtable* pHCtable = pSDManager->GetHCtable();
     _nCollections = pSDManager->GetCollectionCapacity();
-    UFW_DEBUG("There are {} _nCollections.", _nCollections);
+    for (int i = 0; i < pHCtable->entries(); i++) {
+      if (dynamic_cast<Sensor*>(pSDManager->FindSensitiveDetector(pHCtable->GetSDname(i), false))) {
+        sensorCollID.push_back(pSDManager->GetCollectionID(pHCtable->GetSDname(i) + "/" + pHCtable->GetHCname(i)));
+      }
+    }
+    UFW_DEBUG("There are {} _nCollections, {} from sensors.", _nCollections, sensorCollID.size());
   }
 }
 
@@ -39,36 +44,31 @@ void AnalysisManager::EndOfEvent(const G4Event* pEvent) {
   UFW_DEBUG("AnalysisManager::EndOfEvent {}", pEvent->GetEventID() );
   G4HCofThisEvent* pHCofThisEvent = pEvent->GetHCofThisEvent();
   int eventID = pEvent->GetEventID();
-  G4SDManager* pSDManager = G4SDManager::GetSDMpointer();
-  auto& hits = m_optmen_edepsim->set<sand::grain::hits>("hits");
-  const auto& geom = m_optmen_edepsim->instance<geoinfo>();
-  geom.grain().lens_cameras();
-  geom.grain().mask_cameras();
-  //nicko: why starting from 2?
-  for (int i = 2; i < _nCollections; i++) {
-    SensorHit* sensorHit = nullptr;
-    SensorHitCollection* sensorHitsCollection = static_cast<SensorHitCollection*>(pHCofThisEvent->GetHC(i));
+  // the process data is not thread safe: photons go to the slot of the event, merged by the process after the run
+  auto& photons = m_optmen_edepsim->event_photons(eventID);
+
+  std::size_t totEntries = 0;
+  for (G4int collID : sensorCollID) {
+    totEntries += pHCofThisEvent->GetHC(collID)->GetSize();
+  }
+  photons.reserve(photons.size() + totEntries);
+
+  for (G4int collID : sensorCollID) {
+    SensorHitCollection* sensorHitsCollection = static_cast<SensorHitCollection*>(pHCofThisEvent->GetHC(collID));
     G4int totEntriesScint = sensorHitsCollection->entries();
-    UFW_DEBUG("Collection {} ('{}') has {} entries.", i, sensorHitsCollection->GetName(), totEntriesScint);
-    if (totEntriesScint != 0) {
-      for (int j = 0; j < totEntriesScint; j++) {
-        sensorHit = (*sensorHitsCollection)[j];
-        sand::grain::hits::photon ph;
-        ph.p.SetPx(sensorHit->direction().getX());
-        ph.p.SetPy(sensorHit->direction().getY());
-        ph.p.SetPz(sensorHit->direction().getZ());
-        ph.p.SetE(sensorHit->energy());
-        ph.origin.SetX(sensorHit->originPos().getX());
-        ph.origin.SetY(sensorHit->originPos().getY());
-        ph.origin.SetZ(sensorHit->originPos().getZ());
-        ph.pos.SetXYZT(sensorHit->arrivalPos().getX(), sensorHit->arrivalPos().getY(),
-                       sensorHit->arrivalPos().getZ(), sensorHit->arrivalTime());
-        ph.scatter = sensorHit->scatter();
-        ph.inside_camera = (sensorHit->productionVolume() == sensorHit->camName());
-        ph.camera_id = geom.grain().at(sensorHit->camName()).id;
-        ph.true_hit = sensorHit->truth();
-        hits.photons.push_back(ph);
-      }
+    UFW_DEBUG("Collection {} ('{}') has {} entries.", collID, sensorHitsCollection->GetName(), totEntriesScint);
+    for (int j = 0; j < totEntriesScint; j++) {
+      const SensorHit* sensorHit = (*sensorHitsCollection)[j];
+      auto& ph = photons.emplace_back();
+      ph.p.SetPxPyPzE(sensorHit->direction().getX(), sensorHit->direction().getY(), sensorHit->direction().getZ(),
+                      sensorHit->energy());
+      ph.origin.SetXYZ(sensorHit->originPos().getX(), sensorHit->originPos().getY(), sensorHit->originPos().getZ());
+      ph.pos.SetXYZT(sensorHit->arrivalPos().getX(), sensorHit->arrivalPos().getY(),
+                     sensorHit->arrivalPos().getZ(), sensorHit->arrivalTime());
+      ph.scatter = sensorHit->scatter();
+      ph.inside_camera = sensorHit->insideCamera();
+      ph.camera_id = sensorHit->camera();
+      ph.true_hit = sensorHit->truth();
     }
   }
 }
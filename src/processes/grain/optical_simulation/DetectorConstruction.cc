@@ -34,6 +34,11 @@
 #include "G4SDManager.hh"
 #include "G4NistManager.hh"
 #include "G4GDMLParser.hh"
+#include "G4PhysicalVolumeStore.hh"
+
+#include <geoinfo/geoinfo.hpp>
+#include <geoinfo/grain_info.hpp>
+#include <optical_simulation.hpp>
 
 namespace sand::grain {
 
@@ -47,13 +52,37 @@ DetectorConstruction::DetectorConstruction(const G4GDMLParser& parser, const opt
 
 G4VPhysicalVolume* DetectorConstruction::Construct()
 {
-  
+  mapCameras();
 
   return fParser.GetWorldVolume();
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+void DetectorConstruction::mapCameras()
+{
+  // geoinfo has its own copy of the geometry, so volumes are matched by name, once
+  const auto& grain = m_optmen_edepsim->geometry().grain();
+  std::unordered_map<std::string, channel_id::link_t> ids;
+  for (const auto& cam : grain.lens_cameras()) {
+    ids.emplace(cam.name, cam.id);
+  }
+  for (const auto& cam : grain.mask_cameras()) {
+    ids.emplace(cam.name, cam.id);
+  }
+
+  m_cameras.clear();
+  for (const G4VPhysicalVolume* pv : *G4PhysicalVolumeStore::GetInstance()) {
+    auto id = ids.find(pv->GetName());
+    if (id != ids.end()) {
+      m_cameras.emplace(pv, id->second);
+    }
+  }
+  UFW_DEBUG("Found {} camera volumes out of {} cameras.", m_cameras.size(), ids.size());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 void DetectorConstruction::ConstructSDandField()
 {
   //G4AutoLock lock(&sensitiveDetMutex);
@@ -113,7 +142,7 @@ void DetectorConstruction::ConstructSDandField()
         std::string trackerChamberSDname = auxItem->value;
         std::string trackerChamberHitCollectionName = trackerChamberSDname + "_collection";
 
-        Sensor* aTrackerSD = new Sensor(trackerChamberSDname, trackerChamberHitCollectionName, m_optmen_edepsim);
+        Sensor* aTrackerSD = new Sensor(trackerChamberSDname, trackerChamberHitCollectionName, m_optmen_edepsim, m_cameras);
         SDman->AddNewDetector( aTrackerSD );   
         G4VSensitiveDetector* mydet = SDman->FindSensitiveDetector(trackerChamberSDname);
       
@@ -39,12 +39,19 @@
 #include "G4LogicalSkinSurface.hh" 
 #include "G4SurfaceProperty.hh"
 
+#include <common/sand.h>
+
+#include <unordered_map>
 
 class G4GDMLParser;
+class G4VPhysicalVolume;
 
 namespace sand::grain {
 class optical_simulation;
 
+/// Camera id of the placed camera volumes, the mothers of the sensors
+using camera_volume_map = std::unordered_map<const G4VPhysicalVolume*, channel_id::link_t>;
+
 struct logicalVolumeStruct {
   G4LogicalVolume* _logicalVolume;
   G4SurfaceProperty* _skinProp;
@@ -64,6 +71,9 @@ class DetectorConstruction : public G4VUserDetectorConstruction
     virtual void ConstructSDandField();
     virtual G4LogicalVolume *findLogicalDetector(G4LogicalVolume *l, std::string name);
 
+  private:
+    void mapCameras();
+
   private:
     const G4GDMLParser& fParser;
     G4int NSiPMs;
@@ -73,6 +83,9 @@ class DetectorConstruction : public G4VUserDetectorConstruction
     G4LogicalVolumeStore *lstore;
     const optical_simulation* m_optmen_edepsim; 
 
+    // Built by Construct on the master, only read by the sensors of the workers
+    camera_volume_map m_cameras;
+
 };
 }
 #endif
\ No newline at end of file
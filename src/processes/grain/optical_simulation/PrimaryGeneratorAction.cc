@@ -36,6 +36,7 @@
 #include "G4ParticleDefinition.hh"
 #include "PrimaryGeneratorAction.hh"
 #include "G4SystemOfUnits.hh"
+#include <algorithm>
 #include <cmath>
 
 #include "G4Navigator.hh"
@@ -44,9 +45,10 @@
 #include "G4OpticalPhoton.hh"
 #include "G4Poisson.hh"
 
-#include <ufw/context.hpp>
 #include <optical_simulation.hpp>
+#include <geoinfo/geoinfo.hpp>
 #include <geoinfo/grain_info.hpp>
+#include <TH1D.h>
 
 namespace sand::grain {
 PrimaryGeneratorAction::PrimaryGeneratorAction(optical_simulation* optmen_edepsim) : m_optmen_edepsim(optmen_edepsim) {
@@ -57,45 +59,31 @@ PrimaryGeneratorAction::PrimaryGeneratorAction(optical_simulation* optmen_edepsi
 PrimaryGeneratorAction::~PrimaryGeneratorAction() {}
 
 void PrimaryGeneratorAction::ApplyTranslation(){
-    const auto& geom = m_optmen_edepsim->instance<geoinfo>();
+    const auto& geom = m_optmen_edepsim->geometry();
     geom.grain().transform().GetTranslation(m_centre);
 }
 
-void PrimaryGeneratorAction::nextIteration() {
-    const auto& tree = m_optmen_edepsim->instance<sand::edep_reader>();
-
-    if(m_optmen_edepsim->getStartRun()) {
-        m_tree_it = tree.begin();
-        m_optmen_edepsim->setStartRun(false);
-    }
-
-    if(m_tree_it == tree.end()) {
-        UFW_FATAL("Reached end of tree");
-    }
-
-    if (m_tree_it->GetHitMap().find(component::GRAIN) == m_tree_it->GetHitMap().end()) {
-        m_tree_it++;
-        m_optmen_edepsim->setNewIteration(true);
-        nextIteration();
-        return;
-    } else {
-        const auto& hit_map = m_tree_it->GetHitMap();
-        const auto& hit_vect = hit_map.at(component::GRAIN);
-        if(m_optmen_edepsim->getNewIteration()) {
-            m_hits_it = hit_vect.begin();
-            m_optmen_edepsim->setNewIteration(false);
-            return;
-        } else {
-            m_hits_it++;
-            if (m_hits_it == hit_vect.end()) {
-                m_tree_it++;
-                m_optmen_edepsim->setNewIteration(true);
-                nextIteration();
-                return;
-            }
-            return;
+// Same as TH1::GetRandom, but drawing from the Geant4 engine of the calling thread instead of the global gRandom, so
+// that workers neither race on it nor depend on each other.
+G4double PrimaryGeneratorAction::SampleComponent(const TH1D& distribution, std::vector<G4double>& cumulative) {
+    const int nbins = distribution.GetNbinsX();
+    if (cumulative.empty()) {
+        cumulative.resize(nbins + 1, 0.);
+        for (int i = 0; i < nbins; i++) {
+            cumulative[i + 1] = cumulative[i] + distribution.GetBinContent(i + 1);
         }
+        for (auto& c : cumulative) {
+            c /= cumulative.back();
+        }
+    }
+    G4double r = G4UniformRand();
+    int bin = std::upper_bound(cumulative.begin(), cumulative.end(), r) - cumulative.begin() - 1;
+    bin = std::clamp(bin, 0, nbins - 1);
+    G4double x = distribution.GetBinLowEdge(bin + 1);
+    if (r > cumulative[bin]) {
+        x += distribution.GetBinWidth(bin + 1) * (r - cumulative[bin]) / (cumulative[bin + 1] - cumulative[bin]);
     }
+    return x;
 }
 
 bool isInArgon(const G4ThreeVector& myPhotonPosition)
@@ -143,17 +131,27 @@ std::pair<G4ThreeVector,G4ThreeVector> PrimaryGeneratorAction::GenerateRandomMom
 
 void PrimaryGeneratorAction::GeneratePrimaries(G4Event *event) {
 
-    event->SetEventID(ufw::context::current()->id());
+    // Reseeding from the event ID gives an event the same photons whichever thread processes it, so the output does
+    // not depend on the number of threads nor on the run manager being sequential.
+    if (auto seed = m_optmen_edepsim->run_seed()) {
+        long seeds[] = {*seed, event->GetEventID() + 1, 0};
+        G4Random::setTheSeeds(seeds);
+    }
 
     // Get lAr info
     m_optmen_edepsim->properties();
 
-    nextIteration();
+    // the run has one event per chunk of energy deposit, in the order of the work list
+    const auto& work = m_optmen_edepsim->work(event->GetEventID());
+    m_trajectory = work.trajectory;
+    m_hit = work.hit;
+    m_chunk_begin = work.begin;
+    m_chunk_end = work.end;
 
     //apply shift
     ApplyTranslation();
 
-    G4int myPDG = m_hits_it->GetPrimaryId();
+    G4int myPDG = m_hit->GetPrimaryId();
     G4ParticleDefinition *myParticle = G4ParticleTable::GetParticleTable()->FindParticle(myPDG);
 
     //This is code from EDepSim to deal with nuclear PDGs
@@ -184,7 +182,7 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event *event) {
     G4double myMass = myParticle->GetPDGMass();
 
     //initial kinetic energy of track
-    G4double myVertexKinEne = m_tree_it->GetInitialMomentum().E();
+    G4double myVertexKinEne = m_trajectory->GetInitialMomentum().E();
 
     // COMPUTATION FOR NUMBER of PHOTONS
     // The fraction of the energy deposit that ends up producing photons is already computed by EDepSim
@@ -192,8 +190,10 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event *event) {
     // This ALREADY takes into account excitons and the fraction of recombinating ions
 
     // photons (excitons + recombinating ions)
-    G4double myphotons = m_hits_it->GetSecondaryDeposit() * m_optmen_edepsim->properties().m_scintillation_yield;
-    m_optmen_edepsim->set_current_truth_id(m_hits_it->GetId());
+    // (the chunk gets its share of them, photons are emitted uniformly along the hit)
+    G4double myphotons = m_hit->GetSecondaryDeposit() * m_optmen_edepsim->properties().m_scintillation_yield
+                         * (m_chunk_end - m_chunk_begin);
+    m_optmen_edepsim->set_current_truth_id(m_hit->GetId());
 
     int myNumPhotons = 0;
     if(myphotons < 20)     myNumPhotons = int(G4Poisson(myphotons) + 0.5);
@@ -216,7 +216,7 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event *event) {
     }
 
     // slow/fast components ratio
-    G4double mySingletTripletRatio = GetSingletTripletRatio(myZ, m_hits_it->GetEnergyDeposit(), myVertexKinEne);
+    G4double mySingletTripletRatio = GetSingletTripletRatio(myZ, m_hit->GetEnergyDeposit(), myVertexKinEne);
 
     G4ParticleDefinition *particle = G4OpticalPhoton::OpticalPhotonDefinition();
     fParticleGun.SetParticleDefinition(particle);
@@ -228,11 +228,11 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event *event) {
         fParticleGun.SetParticleMomentumDirection(myMomentumPolarization.first);
         fParticleGun.SetParticlePolarization(myMomentumPolarization.second);
 
-        G4double random = G4UniformRand(); //random between 0 and 1
+        G4double random = m_chunk_begin + (m_chunk_end - m_chunk_begin) * G4UniformRand(); //random within the chunk of the hit
 
         // Position
-        G4ThreeVector translated_start(m_hits_it->GetStart().X() - m_centre.x(), m_hits_it->GetStart().Y() - m_centre.y(), m_hits_it->GetStart().Z() - m_centre.z());
-        G4ThreeVector translated_stop(m_hits_it->GetStop().X() - m_centre.x(), m_hits_it->GetStop().Y() - m_centre.y(), m_hits_it->GetStop().Z() - m_centre.z());
+        G4ThreeVector translated_start(m_hit->GetStart().X() - m_centre.x(), m_hit->GetStart().Y() - m_centre.y(), m_hit->GetStart().Z() - m_centre.z());
+        G4ThreeVector translated_stop(m_hit->GetStop().X() - m_centre.x(), m_hit->GetStop().Y() - m_centre.y(), m_hit->GetStop().Z() - m_centre.z());
         G4ThreeVector myPhotonPosition = translated_start + random * (translated_stop - translated_start);
 
         if(!isInArgon(myPhotonPosition)) continue; // skip if not in LAr
@@ -240,7 +240,7 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event *event) {
 
         // Time & Energy
         // photonTime = Global Time ( + Recombination Time ) + Singlet/Triplet Time
-        G4double myPhotonTime = m_hits_it->GetStart().T() + random*(m_hits_it->GetStop().T() - m_hits_it->GetStart().T());
+        G4double myPhotonTime = m_hit->GetStart().T() + random*(m_hit->GetStop().T() - m_hit->GetStart().T());
         G4double mySampledEnergy = 0;
 
         // applies scintillation constant according to singlet/triplet ratio
@@ -255,11 +255,11 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event *event) {
         }*/
 
             myPhotonTime -= m_optmen_edepsim->properties().m_tau_fast * log(G4UniformRand());
-            mySampledEnergy = m_optmen_edepsim->properties().m_fast_component_distribution->GetRandom();
+            mySampledEnergy = SampleComponent(*m_optmen_edepsim->properties().m_fast_component_distribution, m_fast_cumulative);
         }
         else{
             myPhotonTime -= m_optmen_edepsim->properties().m_tau_slow * log(G4UniformRand());
-            mySampledEnergy = m_optmen_edepsim->properties().m_slow_component_distribution->GetRandom();
+            mySampledEnergy = SampleComponent(*m_optmen_edepsim->properties().m_slow_component_distribution, m_slow_cumulative);
         }
 
         fParticleGun.SetParticleEnergy(mySampledEnergy);
@@ -280,26 +280,26 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event *event) {
         fParticleGun.SetParticleMomentumDirection(myMomentumPolarization.first);
         fParticleGun.SetParticlePolarization(myMomentumPolarization.second);
 
-        G4double random = G4UniformRand(); //random between 0 and 1
+        G4double random = m_chunk_begin + (m_chunk_end - m_chunk_begin) * G4UniformRand(); //random within the chunk of the hit
 
         // Position
-        G4ThreeVector translated_start(m_hits_it->GetStart().X() - m_centre.x(), m_hits_it->GetStart().Y() - m_centre.y(), m_hits_it->GetStart().Z() - m_centre.z());
-        G4ThreeVector translated_stop(m_hits_it->GetStop().X() - m_centre.x(), m_hits_it->GetStop().Y() - m_centre.y(), m_hits_it->GetStop().Z() - m_centre.z());
+        G4ThreeVector translated_start(m_hit->GetStart().X() - m_centre.x(), m_hit->GetStart().Y() - m_centre.y(), m_hit->GetStart().Z() - m_centre.z());
+        G4ThreeVector translated_stop(m_hit->GetStop().X() - m_centre.x(), m_hit->GetStop().Y() - m_centre.y(), m_hit->GetStop().Z() - m_centre.z());
         G4ThreeVector myPhotonPosition = translated_start + random * (translated_stop - translated_start);
         if(!isInArgon(myPhotonPosition)) continue; // skip if not in LAr
         fParticleGun.SetParticlePosition(myPhotonPosition);
 
         // Time & Energy
         // (slow component only)
-        G4double myPhotonTime = m_hits_it->GetStart().T() + random*(m_hits_it->GetStop().T() - m_hits_it->GetStart().T()) - m_optmen_edepsim->properties().m_tau_slow * log(G4UniformRand());
-        G4double mySampledEnergy = m_optmen_edepsim->properties().m_slow_component_distribution->GetRandom();
+        G4double myPhotonTime = m_hit->GetStart().T() + random*(m_hit->GetStop().T() - m_hit->GetStart().T()) - m_optmen_edepsim->properties().m_tau_slow * log(G4UniformRand());
+        G4double mySampledEnergy = SampleComponent(*m_optmen_edepsim->properties().m_slow_component_distribution, m_slow_cumulative);
 
         fParticleGun.SetParticleEnergy(mySampledEnergy);
         fParticleGun.SetParticleTime(myPhotonTime);
 
         fParticleGun.GeneratePrimaryVertex(event);
     }
-    UFW_DEBUG("Completed photons generation for hit {}", m_hits_it->GetId());
+    UFW_DEBUG("Completed photons generation for hit {}", m_hit->GetId());
 }
 
 /////////////////////////////////////////////////////////////////////////////////
@@ -81,7 +81,7 @@ class PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
 		G4double getERf90 (double ene);
 		G4double GetLArNuclearQuenching(double myene);
 
-		void nextIteration();
+		G4double SampleComponent(const TH1D& distribution, std::vector<G4double>& cumulative);
 	
 	private:
 		G4ParticleGun                fParticleGun;
@@ -96,8 +96,15 @@ class PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
 
 		optical_simulation* m_optmen_edepsim;
 
-		EDEPTree::const_iterator m_tree_it;
-		std::vector<EDEPHit>::const_iterator m_hits_it;
+		const EDEPTrajectory* m_trajectory = nullptr;
+		const EDEPHit* m_hit = nullptr;
+		// Fraction of the hit, from its start, simulated in the current event
+		G4double m_chunk_begin = 0.;
+		G4double m_chunk_end = 1.;
+
+		// Cumulative distributions of the emission spectra, per generator hence per thread
+		std::vector<G4double> m_fast_cumulative;
+		std::vector<G4double> m_slow_cumulative;
 };
 }
 #endif
@@ -43,7 +43,9 @@ RunAction::RunAction(AnalysisManager* mgr)
 }
 
 RunAction::~RunAction()
-{}
+{
+  delete _anMgr;
+}
 
 void RunAction::BeginOfRunAction(const G4Run*)
 { 
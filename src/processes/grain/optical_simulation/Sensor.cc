@@ -24,8 +24,9 @@
 #include "G4OpticalPhoton.hh"
 
 namespace sand::grain {
-Sensor::Sensor(const G4String& name, const G4String& hitsCollectionName, const optical_simulation* optmen_edepsim)
-    : G4VSensitiveDetector(name), _photonDetHitCollection(0), m_optmen_edepsim(optmen_edepsim) {
+Sensor::Sensor(const G4String& name, const G4String& hitsCollectionName, const optical_simulation* optmen_edepsim,
+               const camera_volume_map& cameras)
+    : G4VSensitiveDetector(name), _photonDetHitCollection(0), m_optmen_edepsim(optmen_edepsim), m_cameras(cameras) {
   G4cout << "_photonDetHitCollection:" << hitsCollectionName << G4endl;
   collectionName.insert(hitsCollectionName);
   nHits = 0;
@@ -47,7 +48,6 @@ void Sensor::Initialize(G4HCofThisEvent* hitCollection) {
 G4bool Sensor::ProcessHits(G4Step* aStep, G4TouchableHistory*) {
   if (aStep == NULL) return false;
   G4Track* theTrack = aStep->GetTrack();
-  static bool ihavealreadyprinted = false;
   // Need to know if this is an optical photon
   if (theTrack->GetDefinition() != G4OpticalPhoton::OpticalPhotonDefinition())
     return false;
@@ -56,10 +56,8 @@ G4bool Sensor::ProcessHits(G4Step* aStep, G4TouchableHistory*) {
 
   if (thePostPoint->GetStepStatus() != fGeomBoundary) return false;
 
-  G4OpBoundaryProcess* boundary = 0;
-
   // find the boundary process only once
-  if (!boundary) {
+  if (!m_boundary) {
     G4ProcessManager* pm =
         aStep->GetTrack()->GetDefinition()->GetProcessManager();
     G4int nprocesses = pm->GetProcessListLength();
@@ -67,7 +65,7 @@ G4bool Sensor::ProcessHits(G4Step* aStep, G4TouchableHistory*) {
     G4int i;
     for (i = 0; i < nprocesses; i++) {
       if ((*pv)[i]->GetProcessName() == "OpBoundary") {
-        boundary = (G4OpBoundaryProcess*)(*pv)[i];
+        m_boundary = (G4OpBoundaryProcess*)(*pv)[i];
         break;
       }
     }
@@ -75,19 +73,31 @@ G4bool Sensor::ProcessHits(G4Step* aStep, G4TouchableHistory*) {
 
   G4TouchableHistory* theTouchable =
       (G4TouchableHistory*)(thePostPoint->GetTouchable());
-  G4OpBoundaryProcessStatus boundaryStatus = boundary->GetStatus();
-
-  G4Navigator aNavigator;
-  aNavigator.SetWorldVolume(theTouchable->GetVolume(theTouchable->GetHistoryDepth()));
+  G4OpBoundaryProcessStatus boundaryStatus = m_boundary->GetStatus();
 
-  std::string camName = theTouchable->GetVolume(1)->GetName();
+  // only the boundaries of the sensors are interesting, leave before computing anything else
+  if (boundaryStatus != Detection) return false;
 
-  //temporary fix for rare cases in which touchable is CAM_XX_YY and camName becomes "lar_physical"
-  if(camName.find("CAM") == std::string::npos) return false;
+  //the camera is the mother of the sensor, rare cases in which the touchable is not in a camera are skipped
+  const G4VPhysicalVolume* camera = theTouchable->GetVolume(1);
+  auto cameraId = m_cameras.find(camera);
+  if (cameraId == m_cameras.end()) return false;
 
   G4ThreeVector photonArrive = thePostPoint->GetPosition();
+  // Convert the global coordinate for arriving photons into
+  // the local coordinate of the detector
+  photonArrive =
+      theTouchable->GetHistory()->GetTopTransform().TransformPoint(
+          photonArrive);
+
+  //kill photons from the back (lens assembly is not sealed)
+  if(m_optmen_edepsim->opticsType() != optical_simulation::OpticsType::MASK  &&
+     ( ((G4Box*)theTouchable->GetSolid())->GetZHalfLength() - photonArrive.z() > 0.01) ){
+    return false;
+  }
+
   G4ThreeVector photonPositionOrigin = theTrack->GetVertexPosition();
-  G4String productionVolume = aNavigator.LocateGlobalPointAndSetup(photonPositionOrigin)->GetName();
+  bool insideCamera = originVolume(theTrack, theTouchable) == camera;
   G4ThreeVector photonDirection = thePostPoint->GetMomentumDirection();
   G4ThreeVector photonDirectionOrigin = theTrack->GetVertexMomentumDirection();
   G4double arrivalTime = theTrack->GetGlobalTime();
@@ -106,38 +116,24 @@ G4bool Sensor::ProcessHits(G4Step* aStep, G4TouchableHistory*) {
 
   G4ThreeVector emissionPosition = theTrack->GetVertexPosition();
 
-  bool hitAdded = false;
-  switch (boundaryStatus) {
-    case Absorption:
-      break;
-
-    case Detection:
-
-      // Convert the global coordinate for arriving photons into
-      // the local coordinate of the detector
-      photonArrive =
-          theTouchable->GetHistory()->GetTopTransform().TransformPoint(
-              photonArrive);
-
-	//kill photons from the back (lens assembly is not sealed)
-	if(m_optmen_edepsim->opticsType() != optical_simulation::OpticsType::MASK  &&
-             ( ((G4Box*)theTouchable->GetSolid())->GetZHalfLength() - photonArrive.z() > 0.01) ){
-	      //std::cout << "Killed from the back" << std::endl;
-              break;
-	}
-
-      // Creating the hit and add it to the collection
-      _photonDetHitCollection->insert(
-          new SensorHit(photonArrive, emissionPosition, photonDirection, arrivalTime, energy, scatterAngle, camName, productionVolume, m_optmen_edepsim->current_truth_id()));
-      nHits++;
-      hitAdded = true;
-      break;
-    default:
-
-      break;
-  }
+  // Creating the hit and add it to the collection
+  _photonDetHitCollection->insert(
+      new SensorHit(photonArrive, emissionPosition, photonDirection, arrivalTime, energy, scatterAngle, cameraId->second, insideCamera, m_optmen_edepsim->current_truth_id()));
+  nHits++;
+  return true;
+}
 
-  return hitAdded;
+// The deepest volume in which the photon was emitted. Geant4 records it for primary tracks, which the photons usually
+// are. Otherwise it is located with a navigator of the sensor, created once rather than for every hit.
+const G4VPhysicalVolume* Sensor::originVolume(const G4Track* track, const G4VTouchable* touchable) {
+  if (auto origin = track->GetOriginTouchable(); origin && origin->GetVolume()) {
+    return origin->GetVolume();
+  }
+  if (!m_navigator) {
+    m_navigator = std::make_unique<G4Navigator>();
+    m_navigator->SetWorldVolume(touchable->GetVolume(touchable->GetHistoryDepth()));
+  }
+  return m_navigator->LocateGlobalPointAndSetup(track->GetVertexPosition(), nullptr, false, true);
 }
 
 void Sensor::EndOfEvent(G4HCofThisEvent*) {}
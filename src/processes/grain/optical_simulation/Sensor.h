@@ -11,16 +11,22 @@
 #include "G4ProcessManager.hh"
 #include "G4VSensitiveDetector.hh"
 #include "SensorHit.h"
+#include "DetectorConstruction.hh"
+
+#include <memory>
 
 class G4Step;
 class G4HCofThisEvent;
+class G4Navigator;
+class G4OpBoundaryProcess;
 
 namespace sand::grain {
   class optical_simulation;
 
   class Sensor : public G4VSensitiveDetector {
    public:
-    Sensor(const G4String& name, const G4String& hitsCollectionName, const optical_simulation* optmen_edepsim);
+    Sensor(const G4String& name, const G4String& hitsCollectionName, const optical_simulation* optmen_edepsim,
+           const camera_volume_map& cameras);
     virtual ~Sensor();
     virtual void Initialize(G4HCofThisEvent* hitCollection);
 
@@ -33,9 +39,16 @@ namespace sand::grain {
     G4int nHits;
     G4int collectionID;
 
+   private:
+    const G4VPhysicalVolume* originVolume(const G4Track* track, const G4VTouchable* touchable);
+
    private:
     SensorHitCollection* _photonDetHitCollection;
     const optical_simulation* m_optmen_edepsim;
+    const camera_volume_map& m_cameras;
+    // Sensors are per thread, and so are the processes and the geometry navigation state cached here
+    G4OpBoundaryProcess* m_boundary = nullptr;
+    std::unique_ptr<G4Navigator> m_navigator;
   };
 } // namespace sand::grain
 #endif /* SENSOR_H */
\ No newline at end of file
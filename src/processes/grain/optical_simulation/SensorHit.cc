@@ -16,20 +16,21 @@ SensorHit::SensorHit() {
   _direction = G4ThreeVector(0., 0., 0.);
   _energy = 0;
   _scatter = 0;
-  _camName = "NULL_CAM";
-  _productionVolume = "NULL_VOLUME";
+  _camera = 0;
+  _insideCamera = false;
+  _truth = 0;
 }
 
 SensorHit::SensorHit(G4ThreeVector pArrive, G4ThreeVector pOrigin, G4ThreeVector pDirection, G4double pTime,
-                       G4double pEnergy, G4double pScatter, G4String pCamName, G4String pProductionVolume, int pTruth) {
+                       G4double pEnergy, G4double pScatter, channel_id::link_t pCamera, bool pInsideCamera, int pTruth) {
   _arrivalTime = pTime;
   _posArrive = pArrive;
   _posOrigin = pOrigin;
   _energy = pEnergy;
   _direction = pDirection;
   _scatter = pScatter;
-  _camName = pCamName;
-  _productionVolume = pProductionVolume;
+  _camera = pCamera;
+  _insideCamera = pInsideCamera;
   _truth = pTruth;
 }
 
@@ -44,8 +45,8 @@ const SensorHit& SensorHit::operator=(const SensorHit& right) {
   _energy = right._energy;
   _direction = right._direction;
   _scatter = right._scatter;
-  _camName = right._camName;
-  _productionVolume = right._productionVolume;
+  _camera = right._camera;
+  _insideCamera = right._insideCamera;
   _truth = right._truth;
   return *this;
 }
@@ -54,6 +55,6 @@ G4int SensorHit::operator==(const SensorHit& right) const {
   return (_posArrive == right._posArrive && _posOrigin == right._posOrigin &&
           _arrivalTime == right._arrivalTime && _energy == right._energy && 
           _direction == right._direction && _scatter == right._scatter && 
-          _camName == right._camName && _productionVolume == right._productionVolume && _truth == right._truth);
+          _camera == right._camera && _insideCamera == right._insideCamera && _truth == right._truth);
 }
 }
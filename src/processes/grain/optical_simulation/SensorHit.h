@@ -21,6 +21,8 @@
 
 #include "tls.hh"
 
+#include <common/sand.h>
+
 class G4VTouchable;
 
 namespace sand::grain {
@@ -28,7 +30,7 @@ namespace sand::grain {
    public:
     SensorHit();
     SensorHit(G4ThreeVector pArrive, G4ThreeVector pOrigin, G4ThreeVector pDirection, G4double pTime, G4double pEnergy,
-              G4double pScatter, G4String camName, G4String productionVolume, int pTruth);
+              G4double pScatter, channel_id::link_t pCamera, bool pInsideCamera, int pTruth);
     SensorHit(const SensorHit& orig);
     virtual ~SensorHit();
 
@@ -60,11 +62,11 @@ namespace sand::grain {
     inline void scatter(G4double s) { _scatter = s; };
     inline G4double scatter() const { return _scatter; };
 
-    inline void camName(G4String c) { _camName = c; };
-    inline G4String camName() const { return _camName; };
+    inline void camera(channel_id::link_t c) { _camera = c; };
+    inline channel_id::link_t camera() const { return _camera; };
 
-    inline void productionVolume(G4String c) { _productionVolume = c; };
-    inline G4String productionVolume() const { return _productionVolume; };
+    inline void insideCamera(bool c) { _insideCamera = c; };
+    inline bool insideCamera() const { return _insideCamera; };
 
     inline void truth(int c) { _truth = c; };
     inline int truth() const { return _truth; };
@@ -84,10 +86,10 @@ namespace sand::grain {
     G4double _energy;
     // scatter angle of photons
     G4double _scatter;
-    // name of the camera
-    G4String _camName;
-    // name of the volume in which the photon has been emitted
-    G4String _productionVolume;
+    // geoinfo id of the camera
+    channel_id::link_t _camera;
+    // whether the photon has been emitted in the camera volume itself
+    bool _insideCamera;
     // integer index of the MC truth Edephit
     int _truth;
   };
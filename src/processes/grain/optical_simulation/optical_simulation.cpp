@@ -1,3 +1,4 @@
+#include <cmath>
 #include <filesystem>
 
 #include <ufw/config.hpp>
@@ -7,6 +8,7 @@
 #include <ufw/process.hpp>
 
 #include <edep_reader/edep_reader.hpp>
+#include <geoinfo/geoinfo.hpp>
 #include <optical_simulation.hpp>
 #include <grain/photons.h>
 
@@ -17,6 +19,7 @@
 #include "G4MaterialPropertiesTable.hh"
 #include "G4NistManager.hh"
 #include "PhysicsList.hh"
+#include "Randomize.hh"
 
 #include <geant_gdml_parser/geant_gdml_parser.hpp>
 #include <geant_run_manager/geant_run_manager.hpp>
@@ -30,6 +33,9 @@ namespace sand::grain {
 
     m_energy_split_threshold = cfg.value("energy_split_threshold", m_energy_split_threshold);
     m_geometry               = cfg.at("geometry");
+    if (cfg.contains("seed")) {
+      m_seed = cfg.at("seed").get<long>();
+    }
 
     if (m_geometry.find("lenses") != std::string::npos) {
       m_optics_type = OpticsType::LENS;
@@ -43,17 +49,18 @@ namespace sand::grain {
 
     auto& gdml = instance<geant_gdml_parser>(ufw::public_id(m_geometry));
 
+    m_geoinfo = &instance<geoinfo>();
+
     auto& run_manager = instance<geant_run_manager>();
 
-    run_manager.SetUserInitialization(new DetectorConstruction(gdml, this));
+    run_manager->SetUserInitialization(new DetectorConstruction(gdml, this));
 
-    run_manager.SetUserInitialization(new PhysicsList);
+    run_manager->SetUserInitialization(new PhysicsList);
 
-    // Set user action classes
-    AnalysisManager* pAnalysisManager = new AnalysisManager(this);
-    run_manager.SetUserInitialization(new ActionInitialization(pAnalysisManager, this));
+    // Set user action classes, each worker thread gets its own
+    run_manager->SetUserInitialization(new ActionInitialization(this));
 
-    run_manager.Initialize();
+    run_manager->Initialize();
   }
 
   optical_simulation::optical_simulation() : process({}, {{"hits", "sand::grain::hits"}}) {
@@ -61,29 +68,61 @@ namespace sand::grain {
   }
 
   void optical_simulation::run() {
-    // CLHEP::HepRandom::setTheSeed(m_seed);
-    // CLHEP::HepRandom::showEngineStatus();
-    m_run_start     = true;
-    m_new_iteration = true;
+    if (m_seed) {
+      // seeding from the context makes the photons of a spill independent of the ones simulated before it
+      m_run_seed = *m_seed + static_cast<Long64_t>(ufw::context::current()->id());
+      G4Random::setTheSeed(*m_run_seed);
+    }
+
+    // everything the worker threads read is resolved here, on the thread that owns the context
+    properties();
+    fill_work();
+
+    auto n_events = GetEventsNumber();
+    m_event_photons.assign(n_events, {});
+
+    auto& run_manager = instance<geant_run_manager>();
+    run_manager->BeamOn(n_events);
 
-    instance<geant_run_manager>().BeamOn(GetEventsNumber());
+    // merge in event order, which does not depend on how the events were scheduled on the workers
+    std::size_t n_photons = 0;
+    for (const auto& photons : m_event_photons) {
+      n_photons += photons.size();
+    }
+    auto& hits = set<sand::grain::hits>("hits");
+    hits.photons.reserve(hits.photons.size() + n_photons);
+    for (auto& photons : m_event_photons) {
+      hits.photons.insert(hits.photons.end(), photons.begin(), photons.end());
+    }
+    m_event_photons.clear();
+    m_work.clear();
   }
 
-  int optical_simulation::GetEventsNumber() {
+  void optical_simulation::fill_work() {
     UFW_DEBUG("Computing the number of block for the event");
     const auto& tree = get<sand::edep_reader>();
-    int eventCount   = 0;
+    m_work.clear();
 
     for (auto trj_it = tree.begin(); trj_it != tree.end(); trj_it++) {
-      if (trj_it->GetHitMap().find(component::GRAIN) != trj_it->GetHitMap().end()) {
-        eventCount += trj_it->GetHitMap().at(component::GRAIN).size();
+      auto grain_hits = trj_it->GetHitMap().find(component::GRAIN);
+      if (grain_hits == trj_it->GetHitMap().end()) {
+        continue;
+      }
+      for (const auto& hit : grain_hits->second) {
+        std::size_t chunks = 1;
+        if (m_energy_split_threshold > 0 && hit.GetEnergyDeposit() > m_energy_split_threshold) {
+          chunks = std::ceil(hit.GetEnergyDeposit() / m_energy_split_threshold);
+        }
+        for (std::size_t i = 0; i < chunks; ++i) {
+          m_work.push_back({&*trj_it, &hit, double(i) / chunks, double(i + 1) / chunks});
+        }
       }
     }
-    UFW_DEBUG("Split into {} events.", eventCount);
-
-    return eventCount;
+    UFW_DEBUG("Split into {} events.", m_work.size());
   }
 
+  int optical_simulation::GetEventsNumber() { return m_work.size(); }
+
   const optical_simulation::properties_t& optical_simulation::properties() {
     // Lazy initiallization addresses problem with accessing ??something?? outside of PrimaryGeneratorAction??
     if (!m_properties) {
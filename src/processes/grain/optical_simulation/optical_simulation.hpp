@@ -1,5 +1,7 @@
 #include <deque>
 #include <filesystem>
+#include <optional>
+#include <vector>
 
 #include <ufw/config.hpp>
 #include <ufw/context.hpp>
@@ -11,6 +13,13 @@
 
 #include <TH1D.h>
 
+class EDEPTrajectory;
+class EDEPHit;
+
+namespace sand {
+  class geoinfo;
+}
+
 namespace sand::grain {
 
   class geant_run_manager;
@@ -27,6 +36,19 @@ namespace sand::grain {
       double m_scintillation_yield;
     };
 
+    /**
+     * A GRAIN energy deposit, or a chunk of it, simulated as one Geant4 event. Deposits above the energy split
+     * threshold are cut into equal chunks along the hit, from begin to end as fractions of its length, to bound the
+     * number of photons tracked per event. The list of a context is built once before the run and is only read, by
+     * event ID, while the events are processed.
+     */
+    struct work_item {
+      const EDEPTrajectory* trajectory;
+      const EDEPHit* hit;
+      double begin;
+      double end;
+    };
+
     optical_simulation();
 
     void configure(const ufw::config& cfg) override;
@@ -38,33 +60,43 @@ namespace sand::grain {
 
     double energySplitThreshold() const { return m_energy_split_threshold; }
     int GetEventsNumber();
-    bool getStartRun() const { return m_run_start; }
-    void setStartRun(bool run_start) { m_run_start = run_start; }
-    bool getNewIteration() const { return m_new_iteration; }
-    void setNewIteration(bool new_iteration) { m_new_iteration = new_iteration; }
 
-    mutable std::deque<int> track_ids;
-    mutable std::deque<double> track_times;
+    const work_item& work(int event_id) const { return m_work.at(event_id); }
+
+    const geoinfo& geometry() const { return *m_geoinfo; }
+
+    /// Seed of the current context, from the "seed" option, which the events are seeded from. Empty without a seed.
+    std::optional<long> run_seed() const { return m_run_seed; }
+
+    /// Photons detected in an event, filled by the worker thread that processes it.
+    std::vector<hits::photon>& event_photons(int event_id) { return m_event_photons.at(event_id); }
+
+    // The events are processed on the Geant4 worker threads, so the state of the event being tracked is per thread.
+    static inline thread_local std::deque<double> track_times;
 
     int current_truth_id() const {
-      return m_truth_index;
+      return s_truth_index;
     }
 
     void set_current_truth_id(int mc) {
-      m_truth_index = mc;
+      s_truth_index = mc;
     }
 
    private:
     void init_properties();
+    void fill_work();
 
    private:
     OpticsType m_optics_type;
     std::string m_geometry;
     double m_energy_split_threshold = 100; // MeV
-    bool m_new_iteration;
-    bool m_run_start;
+    std::optional<long> m_seed;
+    std::optional<long> m_run_seed;
     std::unique_ptr<properties_t> m_properties;
-    int m_truth_index;
+    const geoinfo* m_geoinfo = nullptr;
+    std::vector<work_item> m_work;
+    std::vector<std::vector<hits::photon>> m_event_photons;
+    static inline thread_local int s_truth_index = 0;
   };
 
 } // namespace sand::grain
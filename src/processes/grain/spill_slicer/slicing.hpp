@@ -0,0 +1,152 @@
+#pragma once
+
+#include <ufw/utils.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+namespace sand::grain::slicing {
+
+  /// Histogram of the photon times the slice edges are searched in: [min_time, max_time) ns in bins of bin_width ns.
+  struct histogram {
+    histogram(double min, double max, double width) : min_time(min), max_time(max), bin_width(width) {
+      if (!(bin_width > 0.) || !(max_time > min_time)) {
+        UFW_ERROR("Invalid slicing histogram: [{}, {}) ns in bins of {} ns.", min_time, max_time, bin_width);
+      }
+      n_bins = std::ceil((max_time - min_time) / bin_width);
+    }
+
+    /// Bin of time t, n_bins if t is outside of the histogram.
+    std::size_t bin(double t) const {
+      if (t >= min_time && t < max_time) {
+        return std::min(static_cast<std::size_t>(std::floor((t - min_time) / bin_width)), n_bins - 1);
+      }
+      return n_bins;
+    }
+
+    /// Lower edge of bin i.
+    double edge(std::size_t i) const { return min_time + static_cast<double>(i) * bin_width; }
+
+    /// Number of bins within delta ns of a bin. A delta shorter than a bin would compare a bin with itself only.
+    std::size_t close_bins(double delta) const {
+      if (delta < bin_width) {
+        UFW_ERROR("delta_ns_for_comparison ({} ns) is shorter than a slicing bin ({} ns).", delta, bin_width);
+      }
+      return static_cast<std::size_t>(delta / bin_width);
+    }
+
+    double min_time;
+    double max_time;
+    double bin_width;
+    std::size_t n_bins;
+  };
+
+  /// An occupied bin and the number of photons in it.
+  using bin_count = std::pair<std::size_t, double>;
+
+  /// How occupied_bins finds the occupied bins, automatic picks sparse when the signals are few compared to the bins.
+  enum class fill_mode { automatic, sparse, dense };
+
+  /**
+   * Occupied bins of the histogram in increasing order, with the sum of the npe of their signals. Signals outside of
+   * the histogram are passed to outside and not counted. The sparse mode sorts the bins of the signals, the dense one
+   * fills the whole histogram; either way each bin sums its photons in the order of the signals, so both give the same
+   * result.
+   */
+  template <typename Signals, typename Outside>
+  std::vector<bin_count> occupied_bins(const histogram& h, const Signals& signals, Outside&& outside,
+                                       fill_mode mode = fill_mode::automatic) {
+    if (mode == fill_mode::automatic) {
+      mode = signals.size() * 8 < h.n_bins ? fill_mode::sparse : fill_mode::dense;
+    }
+    std::vector<bin_count> occupied;
+    if (mode == fill_mode::sparse) {
+      for (const auto& signal : signals) {
+        auto bin = h.bin(signal.time_rising_edge);
+        if (bin != h.n_bins) {
+          occupied.emplace_back(bin, signal.npe);
+        } else {
+          outside(signal);
+        }
+      }
+      std::stable_sort(occupied.begin(), occupied.end(), [](auto& a, auto& b) { return a.first < b.first; });
+      std::size_t n_occupied = 0;
+      for (const auto& [bin, npe] : occupied) {
+        if (n_occupied != 0 && occupied[n_occupied - 1].first == bin) {
+          occupied[n_occupied - 1].second += npe;
+        } else {
+          occupied[n_occupied++] = {bin, npe};
+        }
+      }
+      occupied.resize(n_occupied);
+    } else {
+      std::vector<double> binned_times(h.n_bins, 0.0);
+      for (const auto& signal : signals) {
+        auto bin = h.bin(signal.time_rising_edge);
+        if (bin != h.n_bins) {
+          binned_times[bin] += signal.npe;
+        } else {
+          outside(signal);
+        }
+      }
+      for (std::size_t i = 0; i != h.n_bins; ++i) {
+        if (binned_times[i] != 0.0) {
+          occupied.emplace_back(i, binned_times[i]);
+        }
+      }
+    }
+    return occupied;
+  }
+
+  /**
+   * Peaks among the occupied bins of a histogram of n_bins: bins holding at least min_count photons and more than any
+   * bin within n_close_bins on either side, empty bins counting as zero and neighbouring counts compared as integers.
+   * Bins closer than n_close_bins to either end of the histogram are never peaks. The maxima on either side come from
+   * monotonic queues, so the cost is linear in the occupied bins whatever n_close_bins is.
+   */
+  inline std::vector<std::size_t> peaks(const std::vector<bin_count>& occupied, std::size_t n_bins,
+                                        std::size_t n_close_bins, double min_count) {
+    std::vector<double> left_max(occupied.size(), 0.0);
+    std::vector<double> right_max(occupied.size(), 0.0);
+    std::deque<std::size_t> window;
+    for (std::size_t k = 0; k != occupied.size(); ++k) {
+      while (!window.empty() && occupied[window.front()].first + n_close_bins < occupied[k].first) {
+        window.pop_front();
+      }
+      left_max[k] = window.empty() ? 0.0 : occupied[window.front()].second;
+      while (!window.empty() && occupied[window.back()].second <= occupied[k].second) {
+        window.pop_back();
+      }
+      window.push_back(k);
+    }
+    window.clear();
+    for (std::size_t k = occupied.size(); k-- != 0;) {
+      while (!window.empty() && occupied[window.front()].first > occupied[k].first + n_close_bins) {
+        window.pop_front();
+      }
+      right_max[k] = window.empty() ? 0.0 : occupied[window.front()].second;
+      while (!window.empty() && occupied[window.back()].second <= occupied[k].second) {
+        window.pop_back();
+      }
+      window.push_back(k);
+    }
+
+    std::vector<std::size_t> result;
+    for (std::size_t k = 0; k != occupied.size(); ++k) {
+      auto [i, count] = occupied[k];
+      if (i < n_close_bins || i + n_close_bins >= n_bins) {
+        continue;
+      }
+      if (count > static_cast<uint64_t>(left_max[k]) && count > static_cast<uint64_t>(right_max[k])
+          && count >= min_count) {
+        result.push_back(i);
+      }
+    }
+    return result;
+  }
+
+} // namespace sand::grain::slicing
@@ -6,10 +6,14 @@
 
 #include <grain/digi.h>
 #include <grain/image.h>
+#include <slicing.hpp>
+#include <truth_options/truth_options.hpp>
 
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <limits>
+#include <numeric>
 #include <vector>
 
 namespace sand::grain {
@@ -23,18 +27,22 @@ namespace sand::grain {
    private:
     double m_min_response_signal;
     double m_delta_ns_for_comparison;
+    slicing::histogram m_histogram{0.0, 20000.0, 200.0};
+    std::size_t m_n_close_bins;
     uint64_t m_stat_photons_processed;
     uint64_t m_stat_photons_accepted;
     uint64_t m_stat_photons_discarded;
     std::vector<double> m_slice_times;
     int m_seed = 0;
     bool m_use_algo;
+    bool m_truth;
 
     void compute_slice_times();
   };
 
   void spill_slicer::configure(const ufw::config& cfg) {
     process::configure(cfg);
+    m_truth = instance<truth_options>().enabled();
     m_slice_times.clear();
     for (auto time : cfg.value("slice_times", m_slice_times)) {
       m_slice_times.push_back(time);
@@ -47,46 +55,35 @@ namespace sand::grain {
       m_use_algo                = true;
       m_min_response_signal     = cfg.at("min_response_signal");
       m_delta_ns_for_comparison = cfg.at("delta_ns_for_comparison");
+      m_histogram               = slicing::histogram(cfg.value("slicing_min_time", 0.0),
+                                                     cfg.value("slicing_max_time", 20000.0),
+                                                     cfg.value("slicing_bin_width", 200.0));
+      m_n_close_bins            = m_histogram.close_bins(m_delta_ns_for_comparison);
     }
   }
 
+  /**
+   * Places the slice edges at the peaks of the photon time distribution of all the cameras. A bin is a peak if it holds
+   * at least min_response_signal photons and more than any bin within delta_ns_for_comparison on either side. Only the
+   * occupied bins are visited, see slicing::occupied_bins and slicing::peaks, so the cost does not depend on the bin
+   * width.
+   */
   void spill_slicer::compute_slice_times() {
-    // Place times into bins
-    const int n_bins{100};
-    const double min_time{0.0};
-    const double max_time{20000.0}; // ns
-    const double bin_width{(max_time - min_time) / n_bins};
-
-    std::array<double, n_bins> binned_times;
-    binned_times.fill(0.0);
-
     const auto& digis_in = get<digi>("digi");
-    for (auto& signal : digis_in.signals) {
-      double time{signal.time_rising_edge};
-      if (time >= min_time && time < max_time) {
-        size_t bin_index = static_cast<size_t>(std::floor((time - min_time) / bin_width));
-        binned_times[bin_index] += signal.npe;
-      } else {
-        UFW_WARN("Digi in channel {} is out of time window for slicing (t = {} ns)", signal.channel().raw, time);
-      }
-    }
-
-    // Go through bins to find slice_edges
-    const size_t n_close_bins = static_cast<size_t>(m_delta_ns_for_comparison / bin_width);
+    auto occupied        = slicing::occupied_bins(m_histogram, digis_in.signals, [](const digi::signal& signal) {
+      UFW_WARN("Digi in channel {} is out of time window for slicing (t = {} ns)", signal.channel().raw,
+               signal.time_rising_edge);
+    });
     m_slice_times.clear();
-    m_slice_times.push_back(min_time);
-    for (size_t i = n_close_bins; i < n_bins - n_close_bins; ++i) {
-      auto center        = binned_times.begin() + i;
-      uint64_t left_max  = *std::max_element(center - n_close_bins, center);
-      uint64_t right_max = *std::max_element(center + 1, center + n_close_bins + 1);
-      if (binned_times[i] > left_max && binned_times[i] > right_max && binned_times[i] >= m_min_response_signal) {
-        m_slice_times.push_back(static_cast<double>(i) * bin_width);
-      }
+    m_slice_times.push_back(m_histogram.min_time);
+    for (auto bin : slicing::peaks(occupied, m_histogram.n_bins, m_n_close_bins, m_min_response_signal)) {
+      m_slice_times.push_back(m_histogram.edge(bin));
     }
-    m_slice_times.push_back(max_time);
+    m_slice_times.push_back(m_histogram.max_time);
   }
 
-  spill_slicer::spill_slicer() : process({{"digi", "sand::grain::digi"}}, {{"images", "sand::grain::images"}}) {
+  spill_slicer::spill_slicer()
+      : process({{"digi", "sand::grain::digi"}}, {{"images", "sand::grain::images"}, {"truth", "sand::truth_pool"}}) {
     UFW_INFO("Creating a spill_slicer process at {}", fmt::ptr(this));
   }
 
@@ -96,51 +93,90 @@ namespace sand::grain {
     m_stat_photons_discarded = 0;
     const auto& digis_in     = get<digi>("digi");
     auto& images_out         = set<images>("images").images;
+    auto& truths             = set<truth_pool>("truth");
     if (m_use_algo) {
       m_slice_times.clear();
       compute_slice_times();
     }
-    for (int img_idx = 0; img_idx < m_slice_times.size() - 1; img_idx++) {
+    if (m_slice_times.size() < 2) {
+      UFW_WARN("No time slice to build images in.");
+      return;
+    }
+    if (!std::is_sorted(m_slice_times.begin(), m_slice_times.end())) {
+      UFW_ERROR("Slice times must be in increasing order.");
+    }
+    const auto& signals = digis_in.signals;
+    const auto n_slices = m_slice_times.size() - 1;
+
+    // every slice has an image for each camera with signals, in order of their first signal
+    std::array<int, std::numeric_limits<channel_id::link_t>::max() + 1> camera_slot;
+    camera_slot.fill(-1);
+    std::vector<channel_id::link_t> cameras;
+    // signals bucketed by slice, keeping their order within a slice
+    std::vector<std::size_t> slice_begin(n_slices + 1, 0);
+    std::vector<int> slice_of(signals.size(), -1);
+    for (std::size_t i = 0; i != signals.size(); ++i) {
+      auto id = signals[i].channel().link;
+      if (camera_slot[id] < 0) {
+        camera_slot[id] = cameras.size();
+        cameras.push_back(id);
+      }
+      auto t    = signals[i].time_rising_edge;
+      auto edge = std::upper_bound(m_slice_times.begin(), m_slice_times.end(), t);
+      if (t >= m_slice_times.front() && edge != m_slice_times.end()) {
+        slice_of[i] = edge - m_slice_times.begin() - 1;
+        ++slice_begin[slice_of[i] + 1];
+      }
+    }
+    std::partial_sum(slice_begin.begin(), slice_begin.end(), slice_begin.begin());
+    std::vector<std::size_t> by_slice(slice_begin.back());
+    auto next = slice_begin;
+    for (std::size_t i = 0; i != signals.size(); ++i) {
+      if (slice_of[i] >= 0) {
+        by_slice[next[slice_of[i]]++] = i;
+      }
+    }
+
+    images_out.reserve(images_out.size() + n_slices * cameras.size());
+    for (std::size_t img_idx = 0; img_idx != n_slices; ++img_idx) {
       UFW_INFO("Building images in time interval [{} - {}] ns", m_slice_times[img_idx], m_slice_times[img_idx + 1]);
       size_t offset = images_out.size();
-      for (auto& signal : digis_in.signals) {
-        auto id = signal.channel().link;
-        auto it = std::find_if(images_out.begin() + offset, images_out.end(),
-                               [id](auto& img) { return img.camera_id == id; });
-        if (it == images_out.end()) {
-          images::image img{id, m_slice_times[img_idx], m_slice_times[img_idx + 1]};
-          images_out.emplace_back(img);
-          it = images_out.end() - 1;
-          it->blank();
-          UFW_DEBUG("Created image for camera id: {}, starting at time: {}", id, m_slice_times[img_idx]);
+      for (auto id : cameras) {
+        images::image img{id, m_slice_times[img_idx], m_slice_times[img_idx + 1]};
+        images_out.emplace_back(img);
+        images_out.back().blank();
+        UFW_DEBUG("Created image for camera id: {}, starting at time: {}", id, m_slice_times[img_idx]);
+      }
+      for (auto i = slice_begin[img_idx]; i != slice_begin[img_idx + 1]; ++i) {
+        const auto& signal = signals[by_slice[i]];
+        auto& image        = images_out[offset + camera_slot[signal.channel().link]];
+        // FIXME this assumes that channel ids and the pixel array are indexed consistently
+        auto& pixel = image.pixels.Array()[signal.channel().channel];
+        if (m_truth) {
+          truths.insert(pixel, signal);
         }
-        m_stat_photons_processed++;
-        if (signal.time_rising_edge >= m_slice_times[img_idx] && signal.time_rising_edge < m_slice_times[img_idx + 1]) {
-          // UFW_DEBUG("signal to be assigned to image {}", img_idx);
-          // FIXME this assumes that channel ids and the pixel array are indexed consistently
-          auto& pixel = it->pixels.Array()[signal.channel().channel];
-          pixel.insert(signal.true_hits());
-          pixel.amplitude += signal.npe;
-          if (std::isnan(pixel.time_first) || (pixel.time_first > signal.time_rising_edge)) {
-            pixel.time_first = signal.time_rising_edge;
-          }
-          m_stat_photons_accepted++;
-        } else {
-          m_stat_photons_discarded++;
+        pixel.amplitude += signal.npe;
+        if (std::isnan(pixel.time_first) || (pixel.time_first > signal.time_rising_edge)) {
+          pixel.time_first = signal.time_rising_edge;
         }
       }
-      for (const auto& img :images_out) {
+      for (auto img = images_out.begin() + offset; img != images_out.end(); ++img) {
         size_t maxhits = 0;
         double npe = 0.;
         for (int x = 0; x != camera_width; ++x) {
           for (int y = 0; y != camera_height; ++y) {
-            maxhits = std::max(maxhits, img.pixels[x][y].true_hits().size());
-            npe += img.pixels[x][y].amplitude;
+            maxhits = std::max(maxhits, img->pixels[x][y].true_hits(truths).size());
+            npe += img->pixels[x][y].amplitude;
           }
         }
-        UFW_DEBUG("Camera {} recorded a total of {} photons from {} different MC true hits", img.camera_id, npe, maxhits );
+        UFW_DEBUG("Camera {} recorded a total of {} photons from {} different MC true hits", img->camera_id, npe, maxhits );
       }
     }
+    // as when every signal was checked against every slice: processed counts signal-slice pairs, so accepted ones
+    // are those falling in the slice and discarded ones are all the others
+    m_stat_photons_processed = n_slices * signals.size();
+    m_stat_photons_accepted  = by_slice.size();
+    m_stat_photons_discarded = m_stat_photons_processed - m_stat_photons_accepted;
     UFW_INFO("Processed {} photons; {} were accepted, {} discarded.", m_stat_photons_processed, m_stat_photons_accepted,
              m_stat_photons_discarded);
   }
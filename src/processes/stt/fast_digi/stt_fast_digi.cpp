@@ -21,9 +21,10 @@ namespace sand::stt {
     m_drift_velocity = cfg.at("drift_velocity");
     m_wire_velocity  = cfg.at("wire_velocity");
     m_sigma_tdc      = cfg.at("sigma_tdc");
+    m_truth          = instance<truth_options>().enabled();
   }
 
-  stt_fast_digi::stt_fast_digi() : process({}, {{"digi", "sand::tracker::digi"}}) {
+  stt_fast_digi::stt_fast_digi() : process({}, {{"digi", "sand::tracker::digi"}, {"truth", "sand::truth_pool"}}) {
     UFW_DEBUG("Creating a stt_fast_digi process at {}", fmt::ptr(this));
   }
 
@@ -76,6 +77,7 @@ namespace sand::stt {
   void stt_fast_digi::digitize_hits_in_tubes(const std::map<geo_id, std::vector<EDEPHit>>& hits_by_tube) {
     const auto& gi  = get<geoinfo>();
     auto& digi      = set<sand::tracker::digi>("digi");
+    auto& truths    = set<truth_pool>("truth");
     const auto* stt = dynamic_cast<const sand::geoinfo::stt_info*>(&gi.tracker());
 
     if (!stt)
@@ -93,7 +95,12 @@ namespace sand::stt {
 
       auto signal = process_hits_for_wire(hits, *wire);
       if (signal) {
-        std::for_each(hits.begin(), hits.end(), [&signal](const auto& hit) { signal->insert(hit.GetId()); });
+        if (m_truth) {
+          std::vector<truth_index> ids;
+          ids.reserve(hits.size());
+          std::transform(hits.begin(), hits.end(), std::back_inserter(ids), [](const auto& hit) { return hit.GetId(); });
+          static_cast<sand::truth&>(*signal) = truths.intern(std::move(ids));
+        }
         digi.signals.emplace_back(std::move(*signal));
       }
     }
@@ -11,6 +11,7 @@
 #include <geoinfo/tracker_info.hpp>
 #include <root_tgeomanager/root_tgeomanager.hpp>
 #include <tracker/digi.h>
+#include <truth_options/truth_options.hpp>
 
 namespace sand::stt {
 
@@ -39,6 +40,7 @@ namespace sand::stt {
     double m_drift_velocity; //[mm/ns]
     double m_wire_velocity;  //[mm/ns]
     double m_sigma_tdc;      //[ns]
+    bool m_truth;            // whether signals carry the ids of their hits
   };
 
 } // namespace sand::stt
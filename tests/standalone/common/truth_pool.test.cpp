@@ -0,0 +1,96 @@
+#define BOOST_TEST_MODULE truth_pool
+#include <boost/test/included/unit_test.hpp>
+
+#include <common/truth.h>
+#include <test_helpers.hpp>
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace sand;
+
+namespace {
+
+  std::vector<std::size_t> values(truth_view hits) {
+    std::vector<std::size_t> ret;
+    for (const auto& i : hits) {
+      ret.push_back(truth::raw_value(i));
+    }
+    return ret;
+  }
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(single_hits_need_no_pool) {
+  truth empty;
+  truth one(truth_index(42));
+  BOOST_TEST(empty.empty());
+  BOOST_TEST(empty.true_hits().empty());
+  BOOST_TEST(one.self_contained());
+  BOOST_TEST(values(one.true_hits()) == std::vector<std::size_t>{42}, boost::test_tools::per_element());
+  truth_pool pool;
+  BOOST_TEST(values(one.true_hits(pool)) == std::vector<std::size_t>{42}, boost::test_tools::per_element());
+  BOOST_TEST(pool.size() == 0u);
+}
+
+BOOST_AUTO_TEST_CASE(sets_are_interned_once) {
+  truth_pool pool;
+  auto a = pool.intern({truth_index(7), truth_index(3), truth_index(7), truth_index(5)});
+  auto b = pool.intern({truth_index(5), truth_index(3), truth_index(7)});
+  BOOST_TEST(!a.self_contained());
+  BOOST_TEST((a == b));
+  BOOST_TEST(pool.size() == 1u);
+  BOOST_TEST(values(pool.hits(a)) == (std::vector<std::size_t>{3, 5, 7}), boost::test_tools::per_element());
+  BOOST_CHECK_THROW(a.true_hits(), std::logic_error);
+  BOOST_TEST(pool.intern({truth_index(9), truth_index(9)}).self_contained());
+}
+
+BOOST_AUTO_TEST_CASE(merges_are_unions) {
+  truth_pool pool;
+  truth three(truth_index(3));
+  truth five(truth_index(5));
+  auto both = pool.merge(three, five);
+  BOOST_TEST((both == pool.merge(five, three)));
+  BOOST_TEST((pool.merge(both, three) == both));
+  BOOST_TEST((pool.merge(truth(), both) == both));
+  BOOST_TEST(pool.size() == 1u);
+
+  truth pixel;
+  for (auto i : {5, 3, 5, 5, 3}) {
+    pool.insert(pixel, truth(truth_index(i)));
+  }
+  BOOST_TEST((pixel == both));
+  BOOST_TEST(pool.size() == 1u);
+}
+
+BOOST_AUTO_TEST_CASE(merges_match_std_set) {
+  std::mt19937 rng(12345);
+  std::uniform_int_distribution<std::size_t> hit(0, 40);
+  truth_pool pool;
+  for (int n = 0; n != 200; ++n) {
+    truth merged;
+    std::set<std::size_t> expected;
+    for (int k = 0; k != 10; ++k) {
+      auto i = hit(rng);
+      pool.insert(merged, truth(truth_index(i)));
+      expected.insert(i);
+    }
+    auto got = values(pool.hits(merged));
+    BOOST_TEST(got == std::vector<std::size_t>(expected.begin(), expected.end()), boost::test_tools::per_element());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(copies_keep_handles) {
+  truth_pool pool;
+  auto a = pool.intern({truth_index(1), truth_index(2)});
+  auto b = pool.merge(a, truth(truth_index(4)));
+  truth_pool read = pool;
+  BOOST_TEST(values(read.hits(b)) == (std::vector<std::size_t>{1, 2, 4}), boost::test_tools::per_element());
+  BOOST_TEST((read.intern({truth_index(2), truth_index(1)}) == a));
+  BOOST_TEST((read.merge(b, truth(truth_index(2))) == b));
+  BOOST_TEST(read.size() == pool.size());
+}
+
+FIX_TEST_EXIT
@@ -0,0 +1,204 @@
+#define BOOST_TEST_MODULE edep_tree
+#include <boost/test/included/unit_test.hpp>
+
+#include <edep_reader/EDEPTree.h>
+#include <test_helpers.hpp>
+
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace {
+
+  // 0 ─┬─ 1 ─┬─ 3
+  //    │     └─ 4 ── 6
+  //    └─ 2 ─┬─ 5
+  //          └─ 9
+  // 7 ── 8
+  // Each trajectory has two straw hits, with IDs 2 * id and 2 * id + 1.
+  TG4Event make_event() {
+    TG4Event event;
+    const int parents[] = {-1, 0, 0, 1, 1, 2, 4, -1, 7, 2};
+    for (int id = 0; id != 10; ++id) {
+      TG4Trajectory trajectory;
+      trajectory.TrackId  = id;
+      trajectory.ParentId = parents[id];
+      event.Trajectories.push_back(trajectory);
+    }
+    for (int id = 0; id != 10; ++id) {
+      for (int i = 0; i != 2; ++i) {
+        TG4HitSegment segment;
+        segment.Contrib = {id};
+        event.SegmentDetectors["Straw"].push_back(segment);
+      }
+    }
+    return event;
+  }
+
+  std::vector<int> ids(const EDEPTree& tree) {
+    std::vector<int> out;
+    for (const auto& trj : tree) {
+      out.push_back(trj.GetId());
+    }
+    return out;
+  }
+
+  std::vector<int> children_ids(const EDEPTrajectory& trj) {
+    std::vector<int> out;
+    for (const auto& child : trj.GetChildrenTrajectories()) {
+      out.push_back(child.GetId());
+    }
+    return out;
+  }
+
+  // Checks the links of every trajectory against the parent IDs and the depth-first order.
+  void check_links(const EDEPTree& tree) {
+    for (auto it = tree.begin(); it != tree.end(); ++it) {
+      const auto parent = it->GetParent();
+      if (it->GetParentId() == -1) {
+        BOOST_TEST(parent == static_cast<const EDEPTrajectory*>(&tree));
+        BOOST_TEST((tree.GetParentOf(it->GetId()) == tree.end()));
+        BOOST_TEST(it->GetDepth() == 0);
+      } else {
+        BOOST_REQUIRE(parent != nullptr);
+        BOOST_TEST(parent == &*tree.GetTrajectory(it->GetParentId()));
+        BOOST_TEST(parent == &*tree.GetParentOf(it->GetId()));
+        BOOST_TEST(it->GetDepth() == parent->GetDepth() + 1);
+      }
+      BOOST_TEST(&*tree.GetTrajectory(it->GetId()) == &*it);
+      for (const auto& child : it->GetChildrenTrajectories()) {
+        BOOST_TEST(child.GetParent() == &*it);
+      }
+    }
+  }
+
+  // Checks that each hit is found in its trajectory, or not at all if the trajectory left the tree.
+  void check_hits(const EDEPTree& tree) {
+    for (int id = 0; id != 10; ++id) {
+      for (int hit = 2 * id; hit != 2 * id + 2; ++hit) {
+        auto it = tree.GetTrajectoryWithHitId(hit);
+        if (tree.HasTrajectory(id)) {
+          BOOST_REQUIRE(it != tree.end());
+          BOOST_TEST(it->GetId() == id);
+          BOOST_REQUIRE(tree.GetHitWithIdInDetector(hit, component::STRAW) != nullptr);
+          BOOST_TEST(tree.GetHitWithIdInDetector(hit, component::STRAW)->GetId() == hit);
+        } else {
+          BOOST_TEST((it == tree.end()));
+          BOOST_TEST(tree.GetHitWithIdInDetector(hit, component::STRAW) == nullptr);
+        }
+      }
+    }
+  }
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(edep_tree_build) {
+  EDEPTree tree;
+  tree.InizializeFromEdep(make_event(), {}, false);
+  BOOST_TEST(ids(tree) == (std::vector<int>{0, 1, 3, 4, 6, 2, 5, 9, 7, 8}));
+  BOOST_TEST(children_ids(tree) == (std::vector<int>{0, 7}));
+  BOOST_TEST(children_ids(*tree.GetTrajectory(1)) == (std::vector<int>{3, 4}));
+  BOOST_TEST(tree.GetTrajectory(6)->GetDepth() == 3);
+  check_links(tree);
+  check_hits(tree);
+}
+
+BOOST_AUTO_TEST_CASE(edep_tree_remove_add) {
+  EDEPTree tree;
+  tree.InizializeFromEdep(make_event(), {}, false);
+  EDEPTrajectory removed = *tree.GetTrajectory(1);
+  tree.RemoveTrajectory(1);
+  BOOST_TEST(ids(tree) == (std::vector<int>{0, 2, 5, 9, 7, 8}));
+  check_links(tree);
+  check_hits(tree);
+
+  // The copy keeps its whole subtree, which comes back with it as the last child of its parent.
+  tree.AddTrajectory(removed);
+  BOOST_TEST(ids(tree) == (std::vector<int>{0, 2, 5, 9, 1, 3, 4, 6, 7, 8}));
+  check_links(tree);
+  check_hits(tree);
+
+  // Adding an ID which is already in the tree does nothing.
+  tree.AddTrajectory(removed);
+  BOOST_TEST(tree.size() == 10u);
+
+  // Primaries come back as the last child of the tree.
+  EDEPTrajectory primary = *tree.GetTrajectory(0);
+  tree.RemoveTrajectory(0);
+  BOOST_TEST(ids(tree) == (std::vector<int>{7, 8}));
+  check_links(tree);
+  tree.AddTrajectory(primary);
+  BOOST_TEST(ids(tree) == (std::vector<int>{7, 8, 0, 2, 5, 9, 1, 3, 4, 6}));
+  check_links(tree);
+  check_hits(tree);
+}
+
+BOOST_AUTO_TEST_CASE(edep_tree_move) {
+  EDEPTree tree;
+  tree.InizializeFromEdep(make_event(), {}, false);
+  // Backwards, leaving 9 after both blocks while its parent moves.
+  tree.MoveTrajectoryTo(5, 3);
+  BOOST_TEST(ids(tree) == (std::vector<int>{0, 1, 3, 5, 4, 6, 2, 9, 7, 8}));
+  check_links(tree);
+  check_hits(tree);
+  // Forwards, to another primary.
+  tree.MoveTrajectoryTo(1, 8);
+  BOOST_TEST(ids(tree) == (std::vector<int>{0, 2, 9, 7, 8, 1, 3, 5, 4, 6}));
+  BOOST_TEST(tree.GetTrajectory(6)->GetDepth() == 4);
+  check_links(tree);
+  check_hits(tree);
+  // Into its own subtree, which does nothing.
+  tree.MoveTrajectoryTo(7, 6);
+  BOOST_TEST(ids(tree) == (std::vector<int>{0, 2, 9, 7, 8, 1, 3, 5, 4, 6}));
+}
+
+BOOST_AUTO_TEST_CASE(edep_tree_copies) {
+  auto tree = std::make_unique<EDEPTree>();
+  tree->InizializeFromEdep(make_event(), {}, false);
+  EDEPTree copy(*tree);
+  std::vector<EDEPTrajectory> filtered;
+  tree->Filter(std::back_inserter(filtered), [](const EDEPTrajectory&) { return true; });
+  BOOST_REQUIRE(filtered.size() == 10u);
+  // Copies keep the parent of the trajectory they copy.
+  BOOST_TEST(filtered[0].GetParent() == tree.get());
+  tree.reset();
+
+  BOOST_TEST(ids(copy) == (std::vector<int>{0, 1, 3, 4, 6, 2, 5, 9, 7, 8}));
+  check_links(copy);
+  check_hits(copy);
+
+  // Copies own their descendants, which outlive the tree. The children of a copy have their parent, the copy, outside
+  // of its arena, deeper descendants find theirs in it.
+  BOOST_TEST(children_ids(filtered[0]) == (std::vector<int>{1, 2}));
+  const auto& first = *filtered[0].GetChildrenTrajectories().begin();
+  BOOST_TEST(first.GetParent() == &filtered[0]);
+  BOOST_TEST(children_ids(first) == (std::vector<int>{3, 4}));
+  for (const auto& child : first.GetChildrenTrajectories()) {
+    BOOST_TEST(child.GetParent() == &first);
+  }
+
+  // Depths computed from the parents go through the copies up to the tree.
+  EDEPTrajectory deep = *copy.GetTrajectory(6);
+  deep.ComputeDepth();
+  BOOST_TEST(deep.GetDepth() == 3);
+  EDEPTrajectory one = *copy.GetTrajectory(1);
+  auto& four         = *std::next(one.GetChildrenTrajectories().begin());
+  four.ComputeDepth();
+  BOOST_TEST(four.GetId() == 4);
+  BOOST_TEST(four.GetDepth() == 2);
+
+  // Moving a tree leaves the trajectories where they are.
+  const EDEPTrajectory* arena = &*copy.begin();
+  EDEPTree moved(std::move(copy));
+  BOOST_TEST(&*moved.begin() == arena);
+  BOOST_TEST(copy.size() == 0u);
+  check_links(moved);
+  check_hits(moved);
+
+  EDEPTree rebuilt;
+  rebuilt.InizializeFromTrj(filtered);
+  BOOST_TEST(ids(rebuilt) == ids(moved));
+  check_links(rebuilt);
+}
+
+FIX_TEST_EXIT
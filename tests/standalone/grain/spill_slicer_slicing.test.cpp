@@ -0,0 +1,154 @@
+#define BOOST_TEST_MODULE spill_slicer_slicing
+#include <boost/test/included/unit_test.hpp>
+
+#include <processes/grain/spill_slicer/slicing.hpp>
+#include <test_helpers.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace sand::grain;
+
+namespace {
+
+  struct test_signal {
+    double time_rising_edge;
+    double npe;
+  };
+
+  auto no_outside = [](const test_signal&) { BOOST_FAIL("Unexpected signal outside of the histogram"); };
+
+  /// Signals in bursts around a few times, so that some bins are peaks, over a uniform background.
+  std::vector<test_signal> make_signals(std::mt19937& rng, const slicing::histogram& h, std::size_t n) {
+    std::uniform_real_distribution<double> uniform(h.min_time, h.max_time);
+    std::uniform_real_distribution<double> npe(0.1, 3.);
+    std::vector<double> bursts(5);
+    std::generate(bursts.begin(), bursts.end(), [&] { return uniform(rng); });
+    std::normal_distribution<double> spread(0., 20. * h.bin_width);
+    std::vector<test_signal> signals;
+    for (std::size_t i = 0; i != n; ++i) {
+      double t = i % 3 == 0 ? uniform(rng) : bursts[i % bursts.size()] + spread(rng);
+      t        = std::clamp(t, h.min_time, std::nextafter(h.max_time, h.min_time));
+      signals.push_back({t, npe(rng)});
+    }
+    return signals;
+  }
+
+  /// The peak search of the original dense histogram, with a full scan of the neighbours of every bin.
+  std::vector<std::size_t> brute_force_peaks(const slicing::histogram& h, const std::vector<test_signal>& signals,
+                                             std::size_t n_close_bins, double min_count) {
+    std::vector<double> binned(h.n_bins, 0.0);
+    for (const auto& s : signals) {
+      binned[h.bin(s.time_rising_edge)] += s.npe;
+    }
+    std::vector<std::size_t> result;
+    for (std::size_t i = n_close_bins; i + n_close_bins < h.n_bins; ++i) {
+      auto left  = *std::max_element(binned.begin() + i - n_close_bins, binned.begin() + i);
+      auto right = *std::max_element(binned.begin() + i + 1, binned.begin() + i + n_close_bins + 1);
+      if (binned[i] > static_cast<uint64_t>(left) && binned[i] > static_cast<uint64_t>(right)
+          && binned[i] >= min_count) {
+        result.push_back(i);
+      }
+    }
+    return result;
+  }
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(histogram_bins) {
+  slicing::histogram h{0., 20000., 200.};
+  BOOST_TEST(h.n_bins == 100u);
+  BOOST_TEST(h.bin(0.) == 0u);
+  BOOST_TEST(h.bin(199.9) == 0u);
+  BOOST_TEST(h.bin(200.) == 1u);
+  BOOST_TEST(h.bin(19999.9) == 99u);
+  BOOST_TEST(h.bin(-0.1) == h.n_bins);
+  BOOST_TEST(h.bin(20000.) == h.n_bins);
+  BOOST_TEST(h.edge(3) == 600.);
+  BOOST_CHECK_THROW((slicing::histogram{0., 20000., 0.}), std::exception);
+  BOOST_CHECK_THROW((slicing::histogram{100., 100., 1.}), std::exception);
+}
+
+BOOST_AUTO_TEST_CASE(close_bins_shorter_than_a_bin_rejected) {
+  slicing::histogram h{0., 20000., 200.};
+  BOOST_CHECK_THROW(h.close_bins(199.), std::exception);
+  BOOST_CHECK_THROW(h.close_bins(0.), std::exception);
+  BOOST_TEST(h.close_bins(200.) == 1u);
+  BOOST_TEST(h.close_bins(1000.) == 5u);
+  BOOST_TEST(h.close_bins(1099.) == 5u);
+}
+
+BOOST_AUTO_TEST_CASE(outside_signals_reported) {
+  slicing::histogram h{100., 1000., 10.};
+  std::vector<test_signal> signals{{50., 1.}, {150., 2.}, {1000., 4.}, {155., 8.}};
+  for (auto mode : {slicing::fill_mode::sparse, slicing::fill_mode::dense}) {
+    std::vector<double> outside;
+    auto record   = [&](const test_signal& s) { outside.push_back(s.time_rising_edge); };
+    auto occupied = slicing::occupied_bins(h, signals, record, mode);
+    BOOST_TEST(outside == (std::vector<double>{50., 1000.}), boost::test_tools::per_element());
+    BOOST_TEST(occupied.size() == 1u);
+    BOOST_TEST(occupied[0].first == 5u);
+    BOOST_TEST(occupied[0].second == 10.);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(sparse_matches_dense_on_fine_bins) {
+  std::mt19937 rng(1234);
+  for (double bin_width : {0.5, 1., 3.7}) {
+    slicing::histogram h{-500., 20000., bin_width};
+    for (std::size_t n : {0u, 1u, 10u, 1000u, 5000u}) {
+      auto signals = make_signals(rng, h, n);
+      auto sparse  = slicing::occupied_bins(h, signals, no_outside, slicing::fill_mode::sparse);
+      auto dense   = slicing::occupied_bins(h, signals, no_outside, slicing::fill_mode::dense);
+      // bin contents are summed in the same order, so they are identical, not just close
+      BOOST_TEST((sparse == dense));
+      BOOST_TEST(std::is_sorted(sparse.begin(), sparse.end()));
+      // few signals on fine bins take the sparse path
+      BOOST_TEST((slicing::occupied_bins(h, signals, no_outside) == sparse));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(peaks_match_brute_force) {
+  std::mt19937 rng(4321);
+  for (double bin_width : {1., 10., 200.}) {
+    slicing::histogram h{0., 20000., bin_width};
+    for (std::size_t n_close_bins : {std::size_t{1}, std::size_t{2}, std::size_t{7}, std::size_t{50}}) {
+      for (double min_count : {0., 3., 10.}) {
+        for (std::size_t n : {0u, 20u, 400u, 4000u}) {
+          auto signals  = make_signals(rng, h, n);
+          auto occupied = slicing::occupied_bins(h, signals, no_outside);
+          auto found    = slicing::peaks(occupied, h.n_bins, n_close_bins, min_count);
+          auto expected = brute_force_peaks(h, signals, n_close_bins, min_count);
+          BOOST_TEST(found == expected, boost::test_tools::per_element());
+        }
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(peaks_ties_and_edges) {
+  // bins:               0  1  2  3  4  5  6  7  8  9
+  std::vector<double> c{9, 0, 3, 0, 3, 0, 0, 5, 1, 4};
+  std::vector<slicing::bin_count> occupied;
+  for (std::size_t i = 0; i != c.size(); ++i) {
+    if (c[i] != 0.) {
+      occupied.emplace_back(i, c[i]);
+    }
+  }
+  // bins 0 and 9 are at the edges, bins 2 and 4 tie within two bins, bin 0 is within two bins of bin 2
+  BOOST_TEST(slicing::peaks(occupied, c.size(), 1, 0.) == (std::vector<std::size_t>{2, 4, 7}),
+             boost::test_tools::per_element());
+  BOOST_TEST(slicing::peaks(occupied, c.size(), 2, 0.) == (std::vector<std::size_t>{7}),
+             boost::test_tools::per_element());
+  BOOST_TEST(slicing::peaks(occupied, c.size(), 2, 6.) == (std::vector<std::size_t>{}),
+             boost::test_tools::per_element());
+  // neighbours are compared as integers, so 3.4 is larger than a neighbouring 3.5
+  std::vector<slicing::bin_count> fractional{{2, 3.4}, {3, 3.5}, {4, 3.4}};
+  BOOST_TEST(slicing::peaks(fractional, 10, 1, 0.) == (std::vector<std::size_t>{2, 3, 4}),
+             boost::test_tools::per_element());
+}
+
+FIX_TEST_EXIT
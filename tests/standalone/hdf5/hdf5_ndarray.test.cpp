@@ -51,4 +51,40 @@ BOOST_AUTO_TEST_CASE(hdf5_write) {
   UFW_INFO("Wrote to file!");
 }
 
+BOOST_AUTO_TEST_CASE(hdf5_sparse) {
+  UFW_INFO("Writing and reading sparse matrices!");
+  sand::hdf5::ndarray::ndrange range({4, 5, 6, 8});
+  range.set_type(H5::PredType::NATIVE_FLOAT);
+  std::vector<float> dense(range.flat_size(), 0.f);
+  for (size_t i = 0; i < dense.size(); i += 7) {
+    dense[i] = 0.1f * (i % 13);
+  }
+  {
+    ufw::config cfg = ufw::json::parse(R"({ "uri" : "test_write_sparse.h5", "io" : "overwrite", "compression" : 4 })");
+    sand::hdf5::ndarray array(cfg);
+    array.write("cam_dense", range, dense);
+    array.write_sparse("cam_1", sand::hdf5::ndarray::sparse_matrix::compress(range, dense.data()));
+    array.write_sparse("cam_2", sand::hdf5::ndarray::sparse_matrix::compress(range, dense.data(), 0.5f));
+  }
+  ufw::config cfg = ufw::json::parse(R"({ "uri" : "test_write_sparse.h5" })");
+  sand::hdf5::ndarray array(cfg);
+  BOOST_TEST(array.datasets().size() == 1);
+  BOOST_TEST(array.sparse_matrices().size() == 2);
+  std::vector<float> read(range.flat_size());
+  array.read("cam_dense", read);
+  BOOST_TEST(read == dense);
+  auto m1 = array.read_sparse("cam_1");
+  BOOST_CHECK_EQUAL_COLLECTIONS(m1.shape.begin(), m1.shape.end(), range.begin(), range.end());
+  BOOST_TEST(m1.rows() == 4 * 5 * 6);
+  BOOST_TEST(m1.columns() == 8);
+  m1.expand(read.data());
+  BOOST_TEST(read == dense);
+  auto m2 = array.read_sparse("cam_2");
+  BOOST_TEST(m2.values.size() < m1.values.size());
+  m2.expand(read.data());
+  for (size_t i = 0; i < dense.size(); ++i) {
+    BOOST_TEST(read[i] == (dense[i] > 0.5f ? dense[i] : 0.f));
+  }
+}
+
 FIX_TEST_EXIT